@@ -102,6 +102,10 @@ EaseFunction miracle::from_string_ease_function(std::string const& str)
         return EaseFunction::ease_out_bounce;
     else if (str == "ease_in_out_bounce")
         return EaseFunction::ease_in_out_bounce;
+    else if (str == "cubic_bezier")
+        return EaseFunction::cubic_bezier;
+    else if (str == "spring")
+        return EaseFunction::spring;
     else
     {
         mir::log_error("from_string_ease_function: unknown string: %s", str.c_str());
@@ -119,6 +123,8 @@ AnimationType miracle::from_string_animation_type(std::string const& str)
         return AnimationType::grow;
     else if (str == "shrink")
         return AnimationType::shrink;
+    else if (str == "fade")
+        return AnimationType::fade;
     else
     {
         mir::log_error("from_string_animation_type: unknown string: %s", str.c_str());
@@ -19,11 +19,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLE_WM_ANIMATION_DEFINTION_H
 
 #include "mir/geometry/point.h"
+#include <memory>
 #include <optional>
 #include <string>
 
 namespace miracle
 {
+class CubicBezier;
+class EasingTable;
+
 /// Defines an event that can be animated.
 enum class AnimateableEvent
 {
@@ -68,6 +72,13 @@ enum class EaseFunction
     ease_in_bounce,
     ease_out_bounce,
     ease_in_out_bounce,
+
+    /// A CSS-style cubic-bezier(x1, y1, x2, y2) curve
+    cubic_bezier,
+
+    /// A critically damped spring. When a slide is re-targeted mid-flight,
+    /// the spring carries its velocity into the new target.
+    spring,
     max
 };
 
@@ -77,6 +88,9 @@ enum class AnimationType
     slide,
     grow,
     shrink,
+
+    /// Fades the window out
+    fade,
     max
 };
 
@@ -96,6 +110,13 @@ struct AnimationDefinition
     float c5 = 1.3962634015954636;
     float n1 = 7.5625;
     float d1 = 2.75;
+
+    /// The control points of a [EaseFunction::cubic_bezier] curve.
+    std::shared_ptr<CubicBezier const> cubic_bezier;
+
+    /// When set, the ease function is looked up in this table instead of
+    /// being evaluated analytically.
+    std::shared_ptr<EasingTable const> easing_table;
 };
 
 AnimateableEvent from_string_animateable_event(std::string const&);
@@ -16,13 +16,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 
 #include "animator.h"
+#include "easing.h"
 #include "miracle_config.h"
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <ctime>
 #include <mir/server_action_queue.h>
 #define MIR_LOG_COMPONENT "animator"
 #include <mir/log.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/transform.hpp>
 #include <utility>
 
 using namespace miracle;
@@ -30,21 +33,19 @@ using namespace std::chrono_literals;
 
 namespace
 {
-inline glm::vec2 to_glm_vec2(mir::geometry::Point const& p)
+std::chrono::nanoseconds get_thread_cpu_time()
 {
-    return { p.x.as_int(), p.y.as_int() };
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
 }
 
-inline float get_percent_complete(float target, float real)
-{
-    if (target == 0)
-        return 1.f;
+/// The step used to measure the velocity of a slide by finite differences
+constexpr float velocity_step_seconds = 1e-3f;
 
-    float percent = real / target;
-    if (std::isinf(percent) != 0 || percent > 1.f)
-        return 1.f;
-    else
-        return percent;
+inline glm::vec2 to_glm_vec2(mir::geometry::Point const& p)
+{
+    return { p.x.as_int(), p.y.as_int() };
 }
 }
 
@@ -72,25 +73,9 @@ Animation::Animation(
         assert(to != std::nullopt);
         assert(current != std::nullopt);
 
-        // Find out the percentage that we're already through the move. This could be negative, by design.
-        glm::vec2 end = to_glm_vec2(to.value().top_left);
-        glm::vec2 start = to_glm_vec2(from.value().top_left);
-        glm::vec2 real_start = to_glm_vec2(current.value().top_left);
-        auto percent_x = get_percent_complete(end.x - start.x, real_start.x - start.x);
-        auto percent_y = get_percent_complete(end.y - start.y, real_start.y - start.y);
-
-        // Find out the percentage that we're already through the resize. This could be negative, by design.
-        float width_change = to.value().size.width.as_int() - from.value().size.width.as_int();
-        float height_change = to.value().size.height.as_int() - from.value().size.height.as_int();
-        float real_width_change = current.value().size.width.as_int() - from.value().size.width.as_int();
-        float real_height_change = current.value().size.height.as_int() - from.value().size.height.as_int();
-
-        float percent_w = get_percent_complete(width_change, real_width_change);
-        float percent_h = get_percent_complete(height_change, real_height_change);
-
-        float percentage = std::min(percent_x, std::min(percent_y, std::min(percent_w, percent_h)));
-        percentage = std::clamp(percentage, 0.f, 1.f);
-        runtime_seconds = percentage * definition.duration_seconds;
+        // Slides start from wherever the window is now. If this slide replaces
+        // one that is still running, [continue_from] also picks up its velocity.
+        start_position = to_glm_vec2(current.value().top_left);
         break;
     }
     default:
@@ -98,138 +83,8 @@ Animation::Animation(
     }
 }
 
-Animation& Animation::operator=(miracle::Animation const& other)
-{
-    handle = other.handle;
-    definition = other.definition;
-    from = other.from;
-    to = other.to;
-    callback = other.callback;
-    runtime_seconds = other.runtime_seconds;
-    return *this;
-}
-
 namespace
 {
-float ease_out_bounce(AnimationDefinition const& defintion, float x)
-{
-    if (x < 1 / defintion.d1)
-    {
-        return defintion.n1 * x * x;
-    }
-    else if (x < 2 / defintion.d1)
-    {
-        return defintion.n1 * (x -= 1.5f / defintion.d1) * x + 0.75f;
-    }
-    else if (x < 2.5 / defintion.d1)
-    {
-        return defintion.n1 * (x -= 2.25f / defintion.d1) * x + 0.9375f;
-    }
-    else
-    {
-        return defintion.n1 * (x -= 2.625f / defintion.d1) * x + 0.984375f;
-    }
-}
-
-inline float ease(AnimationDefinition const& defintion, float t)
-{
-    // https://easings.net/
-    switch (defintion.function)
-    {
-    case EaseFunction::linear:
-        return t;
-    case EaseFunction::ease_in_sine:
-        return 1 - cosf((t * M_PI) / 2.f);
-    case EaseFunction::ease_in_out_sine:
-        return -(cosf(M_PI * t) - 1) / 2;
-    case EaseFunction::ease_out_sine:
-        return sinf((t * M_PI) / 2.f);
-    case EaseFunction::ease_in_quad:
-        return t * t;
-    case EaseFunction::ease_out_quad:
-        return 1 - (1 - t) * (1 - t);
-    case EaseFunction::ease_in_out_quad:
-        return t < 0.5 ? 2 * t * t : 1 - powf(-2 * t + 2, 2) / 2;
-    case EaseFunction::ease_in_cubic:
-        return t * t * t;
-    case EaseFunction::ease_out_cubic:
-        return 1 - powf(1 - t, 3);
-    case EaseFunction::ease_in_out_cubic:
-        return t < 0.5 ? 4 * t * t * t : 1 - powf(-2 * t + 2, 3) / 2;
-    case EaseFunction::ease_in_quart:
-        return t * t * t * t;
-    case EaseFunction::ease_out_quart:
-        return 1 - powf(1 - t, 4);
-    case EaseFunction::ease_in_out_quart:
-        return t < 0.5 ? 8 * t * t * t * t : 1 - powf(-2 * t + 2, 4) / 2;
-    case EaseFunction::ease_in_quint:
-        return t * t * t * t * t;
-    case EaseFunction::ease_out_quint:
-        return 1 - powf(1 - t, 5);
-    case EaseFunction::ease_in_out_quint:
-        return t < 0.5 ? 16 * t * t * t * t * t : 1 - powf(-2 * t + 2, 5) / 2;
-    case EaseFunction::ease_in_expo:
-        return t == 0 ? 0 : powf(2, 10 * t - 10);
-    case EaseFunction::ease_out_expo:
-        return t == 1 ? 1 : 1 - powf(2, -10 * t);
-    case EaseFunction::ease_in_out_expo:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : t < 0.5 ? powf(2, 20 * t - 10) / 2
-                      : (2 - powf(2, -20 * t + 10)) / 2;
-    case EaseFunction::ease_in_circ:
-        return 1 - sqrtf(1 - powf(t, 2));
-    case EaseFunction::ease_out_circ:
-        return sqrtf(1 - powf(t - 1, 2));
-    case EaseFunction::ease_in_out_circ:
-        return t < 0.5f
-            ? (1 - sqrtf(1 - powf(2 * t, 2))) / 2
-            : (sqrtf(1 - powf(-2 * t + 2, 2)) + 1) / 2;
-    case EaseFunction::ease_in_back:
-        return defintion.c3 * t * t * t - defintion.c1 * t * t;
-    case EaseFunction::ease_out_back:
-    {
-        return 1 + defintion.c3 * powf(t - 1, 3) + defintion.c1 * powf(t - 1, 2);
-    }
-    case EaseFunction::ease_in_out_back:
-        return t < 0.5
-            ? (powf(2 * t, 2) * ((defintion.c2 + 1) * 2 * t - defintion.c2)) / 2
-            : (powf(2 * t - 2, 2) * ((defintion.c2 + 1) * (t * 2 - 2) + defintion.c2) + 2) / 2;
-    case EaseFunction::ease_in_elastic:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : -powf(2, 10 * t - 10) * sinf((t * 10 - 10.75f) * defintion.c4);
-    case EaseFunction::ease_out_elastic:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : powf(2, -10 * t) * sinf((t * 10 - 0.75f) * defintion.c4) + 1;
-    case EaseFunction::ease_in_out_elastic:
-        return t == 0
-            ? 0
-            : t == 1
-            ? 1
-            : t < 0.5
-            ? -(powf(2, 20 * t - 10) * sinf((20 * t - 11.125f) * defintion.c5)) / 2
-            : (powf(2, -20 * t + 10) * sinf((20 * t - 11.125f) * defintion.c5)) / 2 + 1;
-    case EaseFunction::ease_in_bounce:
-        return 1 - ease_out_bounce(defintion, 1 - t);
-    case EaseFunction::ease_out_bounce:
-        return ease_out_bounce(defintion, t);
-    case EaseFunction::ease_in_out_bounce:
-        return t < 0.5
-            ? (1 - ease_out_bounce(defintion, 1 - 2 * t)) / 2
-            : (1 + ease_out_bounce(defintion, 2 * t - 1)) / 2;
-    default:
-        return 1.f;
-    }
-}
-
 inline float interpolate_scale(float p, float start, float end)
 {
     float diff = end - start;
@@ -250,6 +105,8 @@ AnimationStepResult Animation::init()
         return { handle, false, {}, {}, glm::mat4(0.f) };
     case AnimationType::shrink:
         return { handle, false, {}, {}, glm::mat4(1.f) };
+    case AnimationType::fade:
+        return { handle, false, {}, {}, {}, 1.f };
     case AnimationType::disabled:
         return {
             handle,
@@ -263,10 +120,93 @@ AnimationStepResult Animation::init()
     }
 }
 
-AnimationStepResult Animation::step()
+void Animation::continue_from(Animation const& previous, AnimationTimePoint now)
+{
+    if (definition.type != AnimationType::slide || previous.definition.type != AnimationType::slide)
+        return;
+
+    float previous_runtime = std::chrono::duration<float>(now - previous.start_time).count();
+    start_position = previous.position_at(previous_runtime);
+    start_velocity = previous.velocity_at(previous_runtime);
+    runtime_seconds = 0.f;
+
+    if (definition.function == EaseFunction::spring)
+        return;
+
+    // The curve alone would set off at its own initial velocity. The difference
+    // from the velocity that the window already has is blended out over the
+    // slide with a Hermite basis function. The curve's velocity is measured
+    // the same way as [velocity_at] measures it, so that the two agree even
+    // for curves that jump at their start, like the expo curves.
+    float h = velocity_step_seconds / definition.duration_seconds;
+    float initial_slope = (-3.f * ease(definition, 0.f) + 4.f * ease(definition, h) - ease(definition, 2 * h)) / (2 * h);
+    auto curve_velocity = (to_glm_vec2(to->top_left) - start_position) * initial_slope / definition.duration_seconds;
+    velocity_correction = start_velocity - curve_velocity;
+}
+
+glm::vec2 Animation::slide_position(float runtime, float eased) const
+{
+    auto target = to_glm_vec2(to->top_left);
+    if (definition.function == EaseFunction::spring)
+    {
+        // A critically damped spring, starting at [start_position] and moving at [start_velocity]
+        float omega = spring_settle_factor / definition.duration_seconds;
+        auto offset = start_position - target;
+        return target + (offset + (start_velocity + omega * offset) * runtime) * expf(-omega * runtime);
+    }
+
+    // T * s * (1 - s)^2 has a slope of 1 at the start of the slide, and is
+    // flat and zero at its end, so the correction does not move the target.
+    float s = std::clamp(runtime / definition.duration_seconds, 0.f, 1.f);
+    float blend = definition.duration_seconds * s * (1.f - s) * (1.f - s);
+    return start_position + (target - start_position) * eased + velocity_correction * blend;
+}
+
+glm::vec2 Animation::position_at(float runtime) const
+{
+    if (runtime >= definition.duration_seconds)
+        return to_glm_vec2(to->top_left);
+
+    return slide_position(runtime, ease(definition, std::max(runtime, 0.f) / definition.duration_seconds));
+}
+
+glm::vec2 Animation::velocity_at(float runtime) const
+{
+    // Second order finite differences: central where possible, and one-sided
+    // at the very start of the slide, where the curve is not defined earlier.
+    constexpr float h = velocity_step_seconds;
+    if (runtime < h)
+    {
+        runtime = std::max(runtime, 0.f);
+        return (-3.f * position_at(runtime) + 4.f * position_at(runtime + h) - position_at(runtime + 2 * h)) / (2 * h);
+    }
+
+    return (position_at(runtime + h) - position_at(runtime - h)) / (2 * h);
+}
+
+void Animation::start(AnimationTimePoint now)
 {
-    runtime_seconds += Animator::timestep_seconds;
+    start_time = now - std::chrono::duration_cast<AnimationClock::duration>(std::chrono::duration<float>(runtime_seconds));
+}
+
+float Animation::advance(AnimationTimePoint now)
+{
+    runtime_seconds = std::chrono::duration<float>(now - start_time).count();
     if (runtime_seconds >= definition.duration_seconds)
+        return 1.f;
+
+    return runtime_seconds / definition.duration_seconds;
+}
+
+AnimationStepResult Animation::step(AnimationTimePoint now)
+{
+    auto t = advance(now);
+    return evaluate(t, t >= 1.f ? 1.f : ease(definition, t));
+}
+
+AnimationStepResult Animation::evaluate(float t, float eased) const
+{
+    if (t >= 1.f)
     {
         return {
             handle,
@@ -277,34 +217,26 @@ AnimationStepResult Animation::step()
         };
     }
 
-    float t = (runtime_seconds / definition.duration_seconds);
     switch (definition.type)
     {
     case AnimationType::slide:
     {
-        auto p = ease(definition, t);
-        auto distance = to.value().top_left - from.value().top_left;
-        float x = (float)distance.dx.as_int() * p;
-        float y = (float)distance.dy.as_int() * p;
-
-        glm::vec2 position = {
-            (float)from.value().top_left.x.as_int() + x,
-            (float)from.value().top_left.y.as_int() + y
-        };
+        auto p = eased;
+        auto position = slide_position(t * definition.duration_seconds, p);
 
         float x_scale = interpolate_scale(p, static_cast<float>(from->size.width.as_value()), static_cast<float>(to->size.width.as_value()));
         float y_scale = interpolate_scale(p, static_cast<float>(from->size.height.as_value()), static_cast<float>(to->size.height.as_value()));
 
-        glm::vec3 translate(
-            (float)-to->size.width.as_value() / 2.f,
-            (float)-to->size.height.as_value() / 2.f,
-            0);
-        auto inverse_translate = -translate;
-        glm::mat4 scale_matrix = glm::translate(
-            glm::scale(
-                glm::translate(translate),
-                glm::vec3(x_scale, y_scale, 1.f)),
-            inverse_translate);
+        // Scales about the center of the window. This is the closed form of
+        // translate(offset) * scale * translate(-offset), which saves two
+        // matrix multiplications per window per frame.
+        float offset_x = (float)-to->size.width.as_value() / 2.f;
+        float offset_y = (float)-to->size.height.as_value() / 2.f;
+        glm::mat4 scale_matrix(1.f);
+        scale_matrix[0][0] = x_scale;
+        scale_matrix[1][1] = y_scale;
+        scale_matrix[3][0] = offset_x * (1.f - x_scale);
+        scale_matrix[3][1] = offset_y * (1.f - y_scale);
 
         return {
             handle,
@@ -316,7 +248,7 @@ AnimationStepResult Animation::step()
     }
     case AnimationType::grow:
     {
-        auto p = ease(definition, t);
+        auto p = eased;
         glm::mat4 transform(
             p, 0, 0, 0,
             0, p, 0, 0,
@@ -326,7 +258,7 @@ AnimationStepResult Animation::step()
     }
     case AnimationType::shrink:
     {
-        auto p = 1.f - ease(definition, t);
+        auto p = 1.f - eased;
         glm::mat4 transform(
             p, 0, 0, 0,
             0, p, 0, 0,
@@ -334,6 +266,8 @@ AnimationStepResult Animation::step()
             0, 0, 0, 1);
         return { handle, false, std::nullopt, std::nullopt, transform };
     }
+    case AnimationType::fade:
+        return { handle, false, std::nullopt, std::nullopt, std::nullopt, 1.f - eased };
     case AnimationType::disabled:
     default:
         return {
@@ -346,16 +280,74 @@ AnimationStepResult Animation::step()
     }
 }
 
+void AnimationSlotMap::insert_or_replace(Animation animation, uint32_t generation)
+{
+    auto handle = animation.get_handle();
+    if (handle >= index_of_handle.size())
+        index_of_handle.resize(handle + 1, npos);
+
+    auto index = index_of_handle[handle];
+    if (index != npos)
+    {
+        animations[index] = std::move(animation);
+        generations[index] = generation;
+        return;
+    }
+
+    index_of_handle[handle] = static_cast<uint32_t>(animations.size());
+    handles.push_back(handle);
+    generations.push_back(generation);
+    animations.push_back(std::move(animation));
+}
+
+void AnimationSlotMap::remove_at(size_t index)
+{
+    index_of_handle[handles[index]] = npos;
+
+    auto last = animations.size() - 1;
+    if (index != last)
+    {
+        handles[index] = handles[last];
+        generations[index] = generations[last];
+        animations[index] = std::move(animations[last]);
+        index_of_handle[handles[index]] = static_cast<uint32_t>(index);
+    }
+
+    handles.pop_back();
+    generations.pop_back();
+    animations.pop_back();
+}
+
+bool AnimationSlotMap::contains(AnimationHandle handle) const
+{
+    return handle < index_of_handle.size() && index_of_handle[handle] != npos;
+}
+
+Animation const* AnimationSlotMap::find(AnimationHandle handle) const
+{
+    if (!contains(handle))
+        return nullptr;
+
+    return &animations[index_of_handle[handle]];
+}
+
 Animator::Animator(
     std::shared_ptr<mir::ServerActionQueue> const& server_action_queue,
-    std::shared_ptr<MiracleConfig> const& config) :
+    std::shared_ptr<MiracleConfig> const& config,
+    Clock clock) :
     server_action_queue { server_action_queue },
-    config { config }
+    config { config },
+    clock { std::move(clock) }
 {
+    set_refresh_rate(default_refresh_rate);
+
+    // Leaves room for [none_animation_handle]
+    callbacks.resize(next_handle);
 }
 
 void Animator::start()
 {
+    running = true;
     run_thread = std::thread([&]()
     { run(); });
 }
@@ -367,25 +359,30 @@ Animator::~Animator()
 
 AnimationHandle Animator::register_animateable()
 {
-    return next_handle++;
+    auto handle = next_handle++;
+    callbacks.resize(next_handle);
+    return handle;
 }
 
 void Animator::append(miracle::Animation&& animation)
 {
     std::lock_guard<std::mutex> lock(processing_lock);
-    for (auto it = queued_animations.begin(); it != queued_animations.end();)
-    {
-        if (it->get_handle() == animation.get_handle())
-        {
-            it = queued_animations.erase(it);
-        }
-        else
-            it++;
-    }
+    start_locked(std::move(animation), clock());
+    cv.notify_one();
+}
+
+void Animator::start_locked(miracle::Animation&& animation, AnimationTimePoint now)
+{
+    if (auto const* previous = queued_animations.find(animation.get_handle()))
+        animation.continue_from(*previous, now);
 
     animation.get_callback()(animation.init());
-    queued_animations.push_back(animation);
-    cv.notify_one();
+    animation.start(now);
+
+    auto& slot = callbacks[animation.get_handle()];
+    slot.callback = animation.get_callback();
+    slot.generation++;
+    queued_animations.insert_or_replace(std::move(animation), slot.generation);
 }
 
 void Animator::window_move(
@@ -417,6 +414,35 @@ void Animator::window_move(
         callback));
 }
 
+void Animator::window_moves(std::vector<WindowMove> const& moves)
+{
+    if (moves.empty())
+        return;
+
+    if (!config->are_animations_enabled())
+    {
+        for (auto const& move : moves)
+        {
+            move.callback(
+                { move.handle,
+                    true,
+                    glm::vec2(move.to.top_left.x.as_int(), move.to.top_left.y.as_int()),
+                    glm::vec2(move.to.size.width.as_int(), move.to.size.height.as_int()),
+                    glm::mat4(1.f) });
+        }
+        return;
+    }
+
+    auto const& definition = config->get_animation_definitions()[(int)AnimateableEvent::window_move];
+    {
+        std::lock_guard<std::mutex> lock(processing_lock);
+        auto now = clock();
+        for (auto const& move : moves)
+            start_locked(Animation(move.handle, definition, move.from, move.to, move.current, move.callback), now);
+    }
+    cv.notify_one();
+}
+
 void Animator::window_open(
     AnimationHandle handle,
     std::function<void(AnimationStepResult const&)> const& callback)
@@ -438,6 +464,25 @@ void Animator::window_open(
         callback));
 }
 
+void Animator::window_close(
+    AnimationHandle handle,
+    std::function<void(AnimationStepResult const&)> const& callback)
+{
+    if (!config->are_animations_enabled())
+    {
+        callback({ handle, true });
+        return;
+    }
+
+    append(Animation(
+        handle,
+        config->get_animation_definitions()[(int)AnimateableEvent::window_close],
+        std::nullopt,
+        std::nullopt,
+        std::nullopt,
+        callback));
+}
+
 void Animator::workspace_switch(
     AnimationHandle handle,
     mir::geometry::Rectangle const& from,
@@ -465,79 +510,185 @@ void Animator::workspace_switch(
         callback));
 }
 
-namespace
+void Animator::set_refresh_rate(double hz)
 {
-struct PendingUpdateData
+    if (hz <= 0)
+    {
+        mir::log_warning("set_refresh_rate: ignoring invalid refresh rate %f", hz);
+        return;
+    }
+
+    frame_interval_ns = static_cast<int64_t>(1e9 / hz);
+}
+
+std::chrono::nanoseconds Animator::get_frame_interval() const
 {
-    AnimationStepResult result;
-    std::function<void(miracle::AnimationStepResult const&)> callback;
-};
+    return std::chrono::nanoseconds(frame_interval_ns.load());
 }
 
 void Animator::run()
 {
-    using clock = std::chrono::high_resolution_clock;
-    constexpr std::chrono::nanoseconds timestep(16ms);
-    std::chrono::nanoseconds lag(0ns);
-    auto time_start = clock::now();
-    running = true;
+    auto const cpu_start = get_thread_cpu_time();
+    std::unique_lock lock(processing_lock);
+    auto next_frame = clock();
 
     while (running)
     {
+        if (queued_animations.empty())
         {
-            std::unique_lock lock(processing_lock);
-            if (queued_animations.empty())
-            {
-                cv.wait(lock);
-                time_start = clock::now();
-            }
+            // Nothing is animating, so sleep until something is
+            cv.wait(lock, [&]() { return !running || !queued_animations.empty(); });
+            next_frame = clock();
+            continue;
         }
 
-        auto delta_time = clock::now() - time_start;
-        time_start = clock::now();
-        lag += std::chrono::duration_cast<std::chrono::nanoseconds>(delta_time);
-
-        while (lag >= timestep)
-        {
-            lag -= timestep;
-            step();
-        }
+        // Sleep until the next frame is due. New animations do not wake the
+        // thread early, as they will be picked up on that frame anyway.
+        if (cv.wait_until(lock, next_frame, [&]() { return !running; }))
+            break;
+
+        lock.unlock();
+        auto now = clock();
+        step(now);
+        frames_stepped++;
+        cpu_time_ns = (get_thread_cpu_time() - cpu_start).count();
+
+        // Animations are evaluated at the time that they are stepped, so frames that
+        // were missed because the thread ran late are skipped rather than replayed.
+        next_frame += get_frame_interval();
+        if (next_frame < now)
+            next_frame = now + get_frame_interval();
+        lock.lock();
     }
 }
 
-void Animator::step()
+AnimatorStats Animator::get_stats() const
+{
+    return {
+        frames_stepped.load(),
+        std::chrono::nanoseconds(cpu_time_ns.load())
+    };
+}
+
+void Animator::step(AnimationTimePoint now)
 {
-    std::vector<PendingUpdateData> update_data;
     {
         std::lock_guard<std::mutex> lock(processing_lock);
-        for (auto it = queued_animations.begin(); it != queued_animations.end();)
+        ease_running_animations(now);
+        for (size_t i = 0; i < queued_animations.size();)
         {
-            auto& item = *it;
-            auto result = item.step();
-
-            update_data.push_back({ result, item.get_callback() });
+            auto result = queued_animations.animation_at(i).evaluate(progress[i], eased[i]);
+            pending_updates.push_back({ result, queued_animations.generation_at(i) });
             if (result.is_complete)
-                it = queued_animations.erase(it);
+            {
+                // Keep the scratch arrays lined up with the slot map's swap-remove
+                auto last = queued_animations.size() - 1;
+                progress[i] = progress[last];
+                eased[i] = eased[last];
+                queued_animations.remove_at(i);
+            }
             else
-                it++;
+                i++;
         }
+
+        // If the server thread has yet to pick up the previous results, these
+        // are appended to them and delivered together.
+        if (pending_updates.empty() || delivery_queued)
+            return;
+
+        delivery_queued = true;
     }
 
-    server_action_queue->enqueue(this, [&, update_data]()
+    server_action_queue->enqueue(this, [this]() { deliver_updates(); });
+}
+
+void Animator::ease_running_animations(AnimationTimePoint now)
+{
+    auto const count = queued_animations.size();
+    progress.resize(count);
+    eased.resize(count);
+    order.resize(count);
+    batch_progress.resize(count);
+    batch_eased.resize(count);
+
+    // Counting sort by ease function, so that animations sharing a curve sit
+    // next to each other in [order]
+    std::array<uint32_t, (size_t)EaseFunction::max + 1> offsets {};
+    for (size_t i = 0; i < count; i++)
     {
-        if (!running)
-            return;
+        progress[i] = queued_animations.animation_at(i).advance(now);
+        offsets[(size_t)queued_animations.animation_at(i).get_definition().function + 1]++;
+    }
+    for (size_t f = 1; f < offsets.size(); f++)
+        offsets[f] += offsets[f - 1];
+    for (size_t i = 0; i < count; i++)
+        order[offsets[(size_t)queued_animations.animation_at(i).get_definition().function]++] = static_cast<uint32_t>(i);
+
+    for (size_t begin = 0; begin < count;)
+    {
+        auto const& definition = queued_animations.animation_at(order[begin]).get_definition();
+        auto end = begin + 1;
+        while (end < count && same_curve(definition, queued_animations.animation_at(order[end]).get_definition()))
+            end++;
+
+        for (auto k = begin; k < end; k++)
+            batch_progress[k] = std::min(progress[order[k]], 1.f);
+        ease_batch(definition, batch_progress.data() + begin, batch_eased.data() + begin, end - begin);
+        for (auto k = begin; k < end; k++)
+            eased[order[k]] = batch_eased[k];
+
+        begin = end;
+    }
+}
+
+void Animator::deliver_updates()
+{
+    {
+        std::lock_guard<std::mutex> lock(processing_lock);
+        std::swap(pending_updates, delivered_updates);
+        delivery_queued = false;
+    }
 
-        for (auto const& update_item : update_data)
-            update_item.callback(update_item.result);
-    });
+    if (!stopping)
+    {
+        for (auto const& update : delivered_updates)
+        {
+            auto const handle = update.result.handle;
+            if (callbacks[handle].generation != update.generation)
+                continue;
+
+            // The callback may start a new animation, which can both replace this
+            // slot and grow [callbacks], so neither the slot nor a reference into
+            // it is held across the call. Moving rather than copying keeps this
+            // path from allocating.
+            auto callback = std::move(callbacks[handle].callback);
+            callbacks[handle].callback = nullptr;
+            callback(update.result);
+
+            if (callbacks[handle].generation == update.generation && !update.result.is_complete)
+                callbacks[handle].callback = std::move(callback);
+        }
+    }
+
+    delivered_updates.clear();
 }
 
 void Animator::stop()
 {
-    if (!running)
+    if (!run_thread.joinable())
         return;
 
-    running = false;
+    stopping = true;
+    {
+        std::lock_guard lock(processing_lock);
+        running = false;
+    }
+    cv.notify_one();
     run_thread.join();
+
+    auto stats = get_stats();
+    mir::log_debug(
+        "Animator stopped after stepping %llu frames with %.2fms of CPU time",
+        static_cast<unsigned long long>(stats.frames),
+        std::chrono::duration<double, std::milli>(stats.cpu_time).count());
 }
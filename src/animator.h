@@ -19,13 +19,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_ANIMATOR_H
 
 #include "animation_defintion.h"
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <glm/glm.hpp>
+#include <limits>
 #include <mir/geometry/rectangle.h>
 #include <mutex>
 #include <optional>
 #include <thread>
+#include <vector>
 
 namespace mir
 {
@@ -42,6 +46,12 @@ typedef uint32_t AnimationHandle;
 /// Reserved for windows who lack an animation handle
 extern const AnimationHandle none_animation_handle;
 
+/// Animations are evaluated against this clock rather than by counting
+/// steps, so they progress at the same speed no matter how often, or how
+/// late, they are stepped.
+using AnimationClock = std::chrono::steady_clock;
+using AnimationTimePoint = AnimationClock::time_point;
+
 /// Callback data provided to the caller on each tick.
 struct AnimationStepResult
 {
@@ -50,6 +60,7 @@ struct AnimationStepResult
     std::optional<glm::vec2> position;
     std::optional<glm::vec2> size;
     std::optional<glm::mat4> transform;
+    std::optional<float> alpha;
 };
 
 class Animation
@@ -63,10 +74,41 @@ public:
         std::optional<mir::geometry::Rectangle> const& current,
         std::function<void(AnimationStepResult const&)> const& callback);
 
-    Animation& operator=(Animation const& other);
+    Animation(Animation const&) = default;
+    Animation(Animation&&) = default;
+    Animation& operator=(Animation const&) = default;
+    Animation& operator=(Animation&&) = default;
 
     AnimationStepResult init();
-    AnimationStepResult step();
+
+    /// Starts the clock on this animation at [now]. If the animation picks up
+    /// partway through, it is treated as having started that much earlier.
+    void start(AnimationTimePoint now);
+
+    /// Evaluates the animation at [now].
+    AnimationStepResult step(AnimationTimePoint now);
+
+    /// Moves the animation's clock to [now] and returns its progress, where
+    /// a progress of 1 means that it has finished.
+    float advance(AnimationTimePoint now);
+
+    /// Builds the result at progress [t], given the ease curve's value
+    /// [eased] at that progress. This lets the caller evaluate the curves of
+    /// many animations in one batch.
+    [[nodiscard]] AnimationStepResult evaluate(float t, float eased) const;
+    [[nodiscard]] AnimationDefinition const& get_definition() const { return definition; }
+
+    /// Picks up a slide from where [previous], which this animation is
+    /// replacing, has got to at [now], moving at the same velocity, so that
+    /// the window curves smoothly onto its new target. Must be called before
+    /// [start].
+    void continue_from(Animation const& previous, AnimationTimePoint now);
+
+    /// The position of a slide [runtime] seconds in.
+    [[nodiscard]] glm::vec2 position_at(float runtime) const;
+
+    /// The velocity of a slide [runtime] seconds in, in pixels per second.
+    [[nodiscard]] glm::vec2 velocity_at(float runtime) const;
     [[nodiscard]] std::function<void(AnimationStepResult const&)> const& get_callback() const { return callback; }
     [[nodiscard]] AnimationHandle get_handle() const { return handle; }
     float get_runtime_seconds() const { return runtime_seconds; }
@@ -78,6 +120,71 @@ private:
     std::optional<mir::geometry::Rectangle> to;
     std::function<void(AnimationStepResult const&)> callback;
     float runtime_seconds = 0.f;
+    AnimationTimePoint start_time;
+
+    /// Where, and how fast, a slide starts out.
+    glm::vec2 start_position { 0.f };
+    glm::vec2 start_velocity { 0.f };
+
+    /// The difference between [start_velocity] and the ease curve's own
+    /// initial velocity, which is blended out over the course of the slide.
+    glm::vec2 velocity_correction { 0.f };
+
+    [[nodiscard]] glm::vec2 slide_position(float runtime, float eased) const;
+};
+
+/// One window's part in a group of moves, see [Animator::window_moves].
+struct WindowMove
+{
+    AnimationHandle handle;
+    mir::geometry::Rectangle from;
+    mir::geometry::Rectangle to;
+    mir::geometry::Rectangle current;
+    std::function<void(AnimationStepResult const&)> callback;
+};
+
+/// Counters describing what the animator thread has cost so far.
+struct AnimatorStats
+{
+    /// The number of frames that the thread has stepped.
+    uint64_t frames = 0;
+
+    /// CPU time consumed by the thread. While nothing is animating, and
+    /// between frames, the thread sleeps and this does not grow.
+    std::chrono::nanoseconds cpu_time { 0 };
+};
+
+/// Dense storage for the running animations, keyed by [AnimationHandle].
+///
+/// Each handle has at most one running animation. Animations are packed
+/// contiguously so that stepping them walks memory in order, and removing
+/// one moves the last animation into its place instead of shifting the rest.
+class AnimationSlotMap
+{
+public:
+    /// Starts tracking [animation], replacing in place the animation that is
+    /// already running for its handle, if there is one.
+    void insert_or_replace(Animation animation, uint32_t generation);
+
+    /// Removes the animation at [index]. The last animation takes its index.
+    void remove_at(size_t index);
+
+    [[nodiscard]] bool contains(AnimationHandle) const;
+    [[nodiscard]] Animation const* find(AnimationHandle) const;
+    [[nodiscard]] size_t size() const { return animations.size(); }
+    [[nodiscard]] bool empty() const { return animations.empty(); }
+    [[nodiscard]] Animation& animation_at(size_t index) { return animations[index]; }
+    [[nodiscard]] AnimationHandle handle_at(size_t index) const { return handles[index]; }
+    [[nodiscard]] uint32_t generation_at(size_t index) const { return generations[index]; }
+
+private:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    /// Indexed by [AnimationHandle], giving the index into the dense arrays.
+    std::vector<uint32_t> index_of_handle;
+    std::vector<AnimationHandle> handles;
+    std::vector<uint32_t> generations;
+    std::vector<Animation> animations;
 };
 
 /// Manages the animation queue. If multiple animations are queued for a window,
@@ -85,13 +192,17 @@ private:
 class Animator
 {
 public:
-    explicit Animator(
+    using Clock = std::function<AnimationTimePoint()>;
+
+    /// [clock] may be replaced to drive the animator from a synthetic time source.
+    Animator(
         std::shared_ptr<mir::ServerActionQueue> const&,
-        std::shared_ptr<MiracleConfig> const&);
+        std::shared_ptr<MiracleConfig> const&,
+        Clock clock = AnimationClock::now);
     ~Animator();
 
     /// Animateable components must register with the Animator before being
-    /// able to be animated.
+    /// able to be animated. Must be called on the server thread.
     AnimationHandle register_animateable();
 
     void window_move(
@@ -101,10 +212,23 @@ public:
         mir::geometry::Rectangle const& current,
         std::function<void(AnimationStepResult const&)> const& callback);
 
+    /// Moves a group of windows that changed together, such as the siblings
+    /// of a container that was laid out again. The whole group is queued
+    /// under a single lock, and every move in it shares a start time and a
+    /// duration, so the windows stay in step and arrive on the same frame.
+    void window_moves(std::vector<WindowMove> const& moves);
+
     void window_open(
         AnimationHandle handle,
         std::function<void(AnimationStepResult const&)> const& callback);
 
+    /// Animates a window that has closed. The window itself is gone by the
+    /// time that this plays, so the callback is expected to animate a
+    /// snapshot of it instead.
+    void window_close(
+        AnimationHandle handle,
+        std::function<void(AnimationStepResult const&)> const& callback);
+
     void workspace_switch(
         AnimationHandle handle,
         mir::geometry::Rectangle const& from,
@@ -114,18 +238,77 @@ public:
 
     void start();
     void stop();
-    void step();
 
-    static constexpr float timestep_seconds = 0.016;
+    /// Evaluates every running animation at [now] and hands the results to
+    /// their callbacks on the server thread.
+    void step(AnimationTimePoint now);
+
+    /// Sets the refresh rate that animations are stepped at. This should be
+    /// the rate of the fastest output, so that no output displays the same
+    /// animation frame twice.
+    void set_refresh_rate(double hz);
+    [[nodiscard]] std::chrono::nanoseconds get_frame_interval() const;
+
+    static constexpr double default_refresh_rate = 60.0;
+
+    /// Safe to call from any thread.
+    [[nodiscard]] AnimatorStats get_stats() const;
 
 private:
+    /// The callback registered for a handle. The generation is bumped each
+    /// time a new animation replaces the callback, so that results from the
+    /// animation that it replaced can be recognized and dropped.
+    struct CallbackSlot
+    {
+        std::function<void(AnimationStepResult const&)> callback;
+        uint32_t generation = 0;
+    };
+
+    struct PendingUpdate
+    {
+        AnimationStepResult result;
+        uint32_t generation;
+    };
+
     void run();
 
+    /// Advances every running animation to [now], filling [progress], and
+    /// evaluates their ease curves in batches of animations that share a
+    /// curve, filling [eased].
+    void ease_running_animations(AnimationTimePoint now);
+    void deliver_updates();
+
     void append(Animation&&);
+
+    /// Starts [animation] at [now]. [processing_lock] must be held.
+    void start_locked(Animation&&, AnimationTimePoint now);
     bool running = false;
+    std::atomic<bool> stopping = false;
+    Clock clock;
+    std::atomic<int64_t> frame_interval_ns;
+    std::atomic<uint64_t> frames_stepped = 0;
+    std::atomic<int64_t> cpu_time_ns = 0;
     std::shared_ptr<mir::ServerActionQueue> server_action_queue;
     std::shared_ptr<MiracleConfig> config;
-    std::vector<Animation> queued_animations;
+    AnimationSlotMap queued_animations;
+
+    /// Scratch space for [ease_running_animations], indexed like [queued_animations]
+    /// except for [order], [batch_progress] and [batch_eased], which are grouped by curve.
+    std::vector<float> progress;
+    std::vector<float> eased;
+    std::vector<uint32_t> order;
+    std::vector<float> batch_progress;
+    std::vector<float> batch_eased;
+
+    /// Indexed by [AnimationHandle]. Only touched on the server thread.
+    std::vector<CallbackSlot> callbacks;
+
+    /// Results are written to [pending_updates] by [step] and swapped into
+    /// [delivered_updates] on the server thread, so that both buffers keep
+    /// their capacity and a steady-state step does not allocate.
+    std::vector<PendingUpdate> pending_updates;
+    std::vector<PendingUpdate> delivered_updates;
+    bool delivery_queued = false;
     std::thread run_thread;
     std::mutex processing_lock;
     std::condition_variable cv;
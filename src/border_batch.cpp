@@ -0,0 +1,91 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "border_batch.h"
+#include "damage_tracker.h"
+
+#include <array>
+#include <cmath>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+void BorderBatch::add(glm::mat4 const& transform, geom::Rectangle const& outer, int width, glm::vec4 const& color)
+{
+    float const left = (float)outer.top_left.x.as_int();
+    float const top = (float)outer.top_left.y.as_int();
+    float const right = left + (float)outer.size.width.as_int();
+    float const bottom = top + (float)outer.size.height.as_int();
+    auto const w = (float)width;
+
+    // Outer then inner corners, clockwise from the top left
+    std::array<glm::vec4, 8> const corners = {
+        transform * glm::vec4(left, top, 0, 1),
+        transform * glm::vec4(right, top, 0, 1),
+        transform * glm::vec4(right, bottom, 0, 1),
+        transform * glm::vec4(left, bottom, 0, 1),
+        transform * glm::vec4(left + w, top + w, 0, 1),
+        transform * glm::vec4(right - w, top + w, 0, 1),
+        transform * glm::vec4(right - w, bottom - w, 0, 1),
+        transform * glm::vec4(left + w, bottom - w, 0, 1),
+    };
+
+    // Each side is a quad between two outer corners and the inner corners next to them
+    glm::vec4 const premultiplied { glm::vec3(color) * color.a, color.a };
+    for (int side = 0; side < 4; side++)
+    {
+        auto const& outer_start = corners[side];
+        auto const& outer_end = corners[(side + 1) % 4];
+        auto const& inner_end = corners[4 + (side + 1) % 4];
+        auto const& inner_start = corners[4 + side];
+        for (auto const& corner : { outer_start, outer_end, inner_end, outer_start, inner_end, inner_start })
+            vertices.push_back({ corner, premultiplied });
+    }
+
+    glm::vec2 min = glm::vec2(corners[0]);
+    glm::vec2 max = min;
+    for (int i = 1; i < 4; i++)
+    {
+        min = glm::min(min, glm::vec2(corners[i]));
+        max = glm::max(max, glm::vec2(corners[i]));
+    }
+
+    auto const x = (int)std::floor(min.x);
+    auto const y = (int)std::floor(min.y);
+    bounds.push_back({
+        geom::Point { x, y },
+        geom::Size { (int)std::ceil(max.x) - x, (int)std::ceil(max.y) - y }
+    });
+}
+
+bool BorderBatch::overlaps(geom::Rectangle const& area) const
+{
+    for (auto const& border : bounds)
+    {
+        auto const overlap = intersection(border, area);
+        if (overlap.size.width.as_int() > 0 && overlap.size.height.as_int() > 0)
+            return true;
+    }
+
+    return false;
+}
+
+void BorderBatch::clear()
+{
+    vertices.clear();
+    bounds.clear();
+}
@@ -0,0 +1,67 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_BORDER_BATCH_H
+#define MIRACLEWM_BORDER_BATCH_H
+
+#include <glm/glm.hpp>
+#include <mir/geometry/rectangle.h>
+#include <vector>
+
+namespace miracle
+{
+
+/// Collects the borders of many windows into a single list of triangles,
+/// so that they can be drawn together with one draw call.
+///
+/// Each border is transformed into the viewport's logical coordinates up
+/// front, so the vertices carry everything that differs between borders
+/// and the shader only needs the uniforms shared by the whole output.
+class BorderBatch
+{
+public:
+    struct Vertex
+    {
+        glm::vec4 position;
+
+        /// Premultiplied by its alpha
+        glm::vec4 color;
+    };
+
+    /// Adds the border of [width] just inside of [outer], which is in the window's
+    /// own coordinates and is moved into the viewport by [transform].
+    void add(glm::mat4 const& transform, mir::geometry::Rectangle const& outer, int width, glm::vec4 const& color);
+
+    /// Whether any of the borders in the batch may draw over [area].
+    [[nodiscard]] bool overlaps(mir::geometry::Rectangle const& area) const;
+
+    [[nodiscard]] bool empty() const { return vertices.empty(); }
+    [[nodiscard]] std::vector<Vertex> const& get_vertices() const { return vertices; }
+
+    /// Empties the batch, keeping its memory for the next one.
+    void clear();
+
+private:
+    std::vector<Vertex> vertices;
+
+    /// The area each border draws to, in the viewport's logical coordinates
+    std::vector<mir::geometry::Rectangle> bounds;
+};
+
+}
+
+#endif // MIRACLEWM_BORDER_BATCH_H
@@ -75,6 +75,12 @@ std::shared_ptr<FloatingContainer> Container::as_floating(std::shared_ptr<Contai
     return std::dynamic_pointer_cast<FloatingContainer>(container);
 }
 
+uint64_t Container::get_id() const
+{
+    // Containers have no stable numeric id of their own, so their address is used
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this));
+}
+
 bool Container::is_leaf()
 {
     return as_leaf(shared_from_this()) != nullptr;
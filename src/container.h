@@ -116,6 +116,10 @@ public:
     bool is_leaf();
     bool is_lane();
 
+    /// Uniquely identifies this container for as long as it is alive. This
+    /// is what i3 calls the con_id.
+    [[nodiscard]] uint64_t get_id() const;
+
     static std::shared_ptr<LeafContainer> as_leaf(std::shared_ptr<Container> const&);
     static std::shared_ptr<ParentContainer> as_parent(std::shared_ptr<Container> const&);
     static std::shared_ptr<FloatingContainer> as_floating(std::shared_ptr<Container> const&);
@@ -0,0 +1,117 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "damage_tracker.h"
+#include <algorithm>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+bool is_empty(geom::Rectangle const& r)
+{
+    return r.size.width.as_int() <= 0 || r.size.height.as_int() <= 0;
+}
+}
+
+geom::Rectangle miracle::bounding_box(geom::Rectangle const& a, geom::Rectangle const& b)
+{
+    if (is_empty(a))
+        return b;
+    if (is_empty(b))
+        return a;
+
+    int const left = std::min(a.top_left.x.as_int(), b.top_left.x.as_int());
+    int const top = std::min(a.top_left.y.as_int(), b.top_left.y.as_int());
+    int const right = std::max(a.top_left.x.as_int() + a.size.width.as_int(), b.top_left.x.as_int() + b.size.width.as_int());
+    int const bottom = std::max(a.top_left.y.as_int() + a.size.height.as_int(), b.top_left.y.as_int() + b.size.height.as_int());
+    return {
+        geom::Point { left, top },
+        geom::Size { right - left, bottom - top }
+    };
+}
+
+geom::Rectangle miracle::intersection(geom::Rectangle const& a, geom::Rectangle const& b)
+{
+    int const left = std::max(a.top_left.x.as_int(), b.top_left.x.as_int());
+    int const top = std::max(a.top_left.y.as_int(), b.top_left.y.as_int());
+    int const right = std::min(a.top_left.x.as_int() + a.size.width.as_int(), b.top_left.x.as_int() + b.size.width.as_int());
+    int const bottom = std::min(a.top_left.y.as_int() + a.size.height.as_int(), b.top_left.y.as_int() + b.size.height.as_int());
+    if (right <= left || bottom <= top)
+        return {};
+
+    return {
+        geom::Point { left, top },
+        geom::Size { right - left, bottom - top }
+    };
+}
+
+void DamageTracker::begin_frame()
+{
+    current.clear();
+}
+
+void DamageTracker::add(Element const& element)
+{
+    current.push_back(element);
+}
+
+std::optional<geom::Rectangle> DamageTracker::end_frame(int buffer_age)
+{
+    FrameDamage damage { full_damage_pending, {} };
+    full_damage_pending = false;
+    if (!damage.full)
+    {
+        auto const common = std::min(previous.size(), current.size());
+        for (size_t i = 0; i < common; i++)
+        {
+            if (previous[i] != current[i])
+                damage.area = bounding_box(damage.area, bounding_box(previous[i].bounds, current[i].bounds));
+        }
+
+        for (size_t i = common; i < previous.size(); i++)
+            damage.area = bounding_box(damage.area, previous[i].bounds);
+        for (size_t i = common; i < current.size(); i++)
+            damage.area = bounding_box(damage.area, current[i].bounds);
+    }
+
+    // The buffers keep their capacity from one frame to the next
+    std::swap(previous, current);
+    std::rotate(history.rbegin(), history.rbegin() + 1, history.rend());
+    history[0] = damage;
+    frames_recorded = std::min(frames_recorded + 1, max_buffer_age);
+
+    // The buffer already shows everything up until [buffer_age] frames ago, so
+    // only what has changed since then needs to be redrawn
+    if (buffer_age <= 0 || buffer_age > frames_recorded)
+        return std::nullopt;
+
+    geom::Rectangle area;
+    for (int i = 0; i < buffer_age; i++)
+    {
+        if (history[i].full)
+            return std::nullopt;
+        area = bounding_box(area, history[i].area);
+    }
+    return area;
+}
+
+void DamageTracker::damage_all()
+{
+    full_damage_pending = true;
+}
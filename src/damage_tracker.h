@@ -0,0 +1,99 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_DAMAGE_TRACKER_H
+#define MIRACLEWM_DAMAGE_TRACKER_H
+
+#include <array>
+#include <cstdint>
+#include <mir/geometry/rectangle.h>
+#include <optional>
+#include <vector>
+
+namespace miracle
+{
+
+/// Works out which part of an output has to be redrawn for a frame, by
+/// comparing what is drawn in it with what was drawn in the frames before.
+///
+/// Elements are compared in the order that they are drawn. When an element
+/// differs from the one drawn at the same place in the previous frame, the
+/// areas covered by both of them are damaged. This also covers elements that
+/// are added, removed or restacked.
+class DamageTracker
+{
+public:
+    /// Everything about a drawn element that decides the pixels it produces.
+    struct Element
+    {
+        /// Identifies the element from one frame to the next
+        void const* id = nullptr;
+
+        /// Changes whenever the element's content does, e.g. a buffer id
+        uint64_t content = 0;
+
+        /// The area that the element draws to, in the output's logical coordinates
+        mir::geometry::Rectangle bounds;
+        float alpha = 1.f;
+        std::array<float, 4> outline_color {};
+
+        bool operator==(Element const&) const = default;
+    };
+
+    /// The most frames back that damage is remembered for. Buffers older
+    /// than this are redrawn in full.
+    static constexpr int max_buffer_age = 4;
+
+    /// Starts recording the elements of a new frame, in drawing order.
+    void begin_frame();
+    void add(Element const&);
+
+    /// Finishes the frame. Returns the area that must be redrawn into a buffer
+    /// that was last drawn [buffer_age] frames ago, which may be empty. A
+    /// buffer age of 0 means that the buffer's contents are unknown. Returns
+    /// std::nullopt when the whole output must be redrawn.
+    std::optional<mir::geometry::Rectangle> end_frame(int buffer_age);
+
+    /// Has the whole output redrawn on the next frame, e.g. because the viewport changed.
+    void damage_all();
+
+private:
+    /// The damage done by a single frame
+    struct FrameDamage
+    {
+        bool full = true;
+        mir::geometry::Rectangle area;
+    };
+
+    std::vector<Element> previous;
+    std::vector<Element> current;
+    bool full_damage_pending = true;
+
+    /// The damage of the most recent frames, newest first
+    std::array<FrameDamage, max_buffer_age> history;
+    int frames_recorded = 0;
+};
+
+/// The smallest rectangle containing both [a] and [b]. Empty rectangles are ignored.
+mir::geometry::Rectangle bounding_box(mir::geometry::Rectangle const& a, mir::geometry::Rectangle const& b);
+
+/// The overlap of [a] and [b], which is empty if they do not overlap.
+mir::geometry::Rectangle intersection(mir::geometry::Rectangle const& a, mir::geometry::Rectangle const& b);
+
+}
+
+#endif // MIRACLEWM_DAMAGE_TRACKER_H
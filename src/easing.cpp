@@ -0,0 +1,458 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "easing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace miracle;
+
+namespace
+{
+/// Four floats, operated on together. The compiler lowers operations on
+/// these to single SSE or NEON instructions.
+typedef float FloatLanes __attribute__((vector_size(4 * sizeof(float))));
+constexpr size_t lane_count = sizeof(FloatLanes) / sizeof(float);
+
+/// Applies [curve] to [count] values of [in], a full set of lanes at a time,
+/// and then one at a time for the remainder.
+template <typename Curve>
+void apply_in_lanes(float const* in, float* out, size_t count, Curve const& curve)
+{
+    size_t i = 0;
+    for (; i + lane_count <= count; i += lane_count)
+    {
+        FloatLanes x;
+        memcpy(&x, in + i, sizeof(x));
+        FloatLanes y = curve(x);
+        memcpy(out + i, &y, sizeof(y));
+    }
+
+    for (; i < count; i++)
+        out[i] = curve(in[i]);
+}
+
+float ease_out_bounce(AnimationDefinition const& defintion, float x)
+{
+    if (x < 1 / defintion.d1)
+    {
+        return defintion.n1 * x * x;
+    }
+    else if (x < 2 / defintion.d1)
+    {
+        return defintion.n1 * (x -= 1.5f / defintion.d1) * x + 0.75f;
+    }
+    else if (x < 2.5 / defintion.d1)
+    {
+        return defintion.n1 * (x -= 2.25f / defintion.d1) * x + 0.9375f;
+    }
+    else
+    {
+        return defintion.n1 * (x -= 2.625f / defintion.d1) * x + 0.984375f;
+    }
+}
+
+float ease_analytic(AnimationDefinition const& defintion, float t)
+{
+    // https://easings.net/
+    switch (defintion.function)
+    {
+    case EaseFunction::linear:
+        return t;
+    case EaseFunction::ease_in_sine:
+        return 1 - cosf((t * M_PI) / 2.f);
+    case EaseFunction::ease_in_out_sine:
+        return -(cosf(M_PI * t) - 1) / 2;
+    case EaseFunction::ease_out_sine:
+        return sinf((t * M_PI) / 2.f);
+    case EaseFunction::ease_in_quad:
+        return t * t;
+    case EaseFunction::ease_out_quad:
+        return 1 - (1 - t) * (1 - t);
+    case EaseFunction::ease_in_out_quad:
+        return t < 0.5 ? 2 * t * t : 1 - powf(-2 * t + 2, 2) / 2;
+    case EaseFunction::ease_in_cubic:
+        return t * t * t;
+    case EaseFunction::ease_out_cubic:
+        return 1 - powf(1 - t, 3);
+    case EaseFunction::ease_in_out_cubic:
+        return t < 0.5 ? 4 * t * t * t : 1 - powf(-2 * t + 2, 3) / 2;
+    case EaseFunction::ease_in_quart:
+        return t * t * t * t;
+    case EaseFunction::ease_out_quart:
+        return 1 - powf(1 - t, 4);
+    case EaseFunction::ease_in_out_quart:
+        return t < 0.5 ? 8 * t * t * t * t : 1 - powf(-2 * t + 2, 4) / 2;
+    case EaseFunction::ease_in_quint:
+        return t * t * t * t * t;
+    case EaseFunction::ease_out_quint:
+        return 1 - powf(1 - t, 5);
+    case EaseFunction::ease_in_out_quint:
+        return t < 0.5 ? 16 * t * t * t * t * t : 1 - powf(-2 * t + 2, 5) / 2;
+    case EaseFunction::ease_in_expo:
+        return t == 0 ? 0 : powf(2, 10 * t - 10);
+    case EaseFunction::ease_out_expo:
+        return t == 1 ? 1 : 1 - powf(2, -10 * t);
+    case EaseFunction::ease_in_out_expo:
+        return t == 0
+            ? 0
+            : t == 1
+            ? 1
+            : t < 0.5 ? powf(2, 20 * t - 10) / 2
+                      : (2 - powf(2, -20 * t + 10)) / 2;
+    case EaseFunction::ease_in_circ:
+        return 1 - sqrtf(1 - powf(t, 2));
+    case EaseFunction::ease_out_circ:
+        return sqrtf(1 - powf(t - 1, 2));
+    case EaseFunction::ease_in_out_circ:
+        return t < 0.5f
+            ? (1 - sqrtf(1 - powf(2 * t, 2))) / 2
+            : (sqrtf(1 - powf(-2 * t + 2, 2)) + 1) / 2;
+    case EaseFunction::ease_in_back:
+        return defintion.c3 * t * t * t - defintion.c1 * t * t;
+    case EaseFunction::ease_out_back:
+    {
+        return 1 + defintion.c3 * powf(t - 1, 3) + defintion.c1 * powf(t - 1, 2);
+    }
+    case EaseFunction::ease_in_out_back:
+        return t < 0.5
+            ? (powf(2 * t, 2) * ((defintion.c2 + 1) * 2 * t - defintion.c2)) / 2
+            : (powf(2 * t - 2, 2) * ((defintion.c2 + 1) * (t * 2 - 2) + defintion.c2) + 2) / 2;
+    case EaseFunction::ease_in_elastic:
+        return t == 0
+            ? 0
+            : t == 1
+            ? 1
+            : -powf(2, 10 * t - 10) * sinf((t * 10 - 10.75f) * defintion.c4);
+    case EaseFunction::ease_out_elastic:
+        return t == 0
+            ? 0
+            : t == 1
+            ? 1
+            : powf(2, -10 * t) * sinf((t * 10 - 0.75f) * defintion.c4) + 1;
+    case EaseFunction::ease_in_out_elastic:
+        return t == 0
+            ? 0
+            : t == 1
+            ? 1
+            : t < 0.5
+            ? -(powf(2, 20 * t - 10) * sinf((20 * t - 11.125f) * defintion.c5)) / 2
+            : (powf(2, -20 * t + 10) * sinf((20 * t - 11.125f) * defintion.c5)) / 2 + 1;
+    case EaseFunction::ease_in_bounce:
+        return 1 - ease_out_bounce(defintion, 1 - t);
+    case EaseFunction::ease_out_bounce:
+        return ease_out_bounce(defintion, t);
+    case EaseFunction::ease_in_out_bounce:
+        return t < 0.5
+            ? (1 - ease_out_bounce(defintion, 1 - 2 * t)) / 2
+            : (1 + ease_out_bounce(defintion, 2 * t - 1)) / 2;
+    case EaseFunction::cubic_bezier:
+        return defintion.cubic_bezier ? defintion.cubic_bezier->solve(t) : t;
+    case EaseFunction::spring:
+    {
+        float k = spring_settle_factor * t;
+        return 1 - (1 + k) * expf(-k);
+    }
+    default:
+        return 1.f;
+    }
+}
+}
+
+CubicBezier::CubicBezier(float x1, float y1, float x2, float y2) :
+    is_linear { x1 == y1 && x2 == y2 },
+    cx { 3 * x1 },
+    cy { 3 * y1 }
+{
+    bx = 3 * (x2 - x1) - cx;
+    ax = 1 - cx - bx;
+    by = 3 * (y2 - y1) - cy;
+    ay = 1 - cy - by;
+
+    for (size_t i = 0; i < table_size; i++)
+        x_table[i] = sample_x(static_cast<float>(i) / (table_size - 1));
+}
+
+float CubicBezier::sample_x(float s) const
+{
+    return ((ax * s + bx) * s + cx) * s;
+}
+
+float CubicBezier::sample_y(float s) const
+{
+    return ((ay * s + by) * s + cy) * s;
+}
+
+float CubicBezier::slope_x(float s) const
+{
+    return (3 * ax * s + 2 * bx) * s + cx;
+}
+
+float CubicBezier::find_parameter(float x) const
+{
+    constexpr float step = 1.f / (table_size - 1);
+
+    // Start from a linear interpolation within the interval that contains x
+    size_t interval = 0;
+    while (interval < table_size - 2 && x_table[interval + 1] <= x)
+        interval++;
+    float interval_start = static_cast<float>(interval) * step;
+    float width = x_table[interval + 1] - x_table[interval];
+    float guess = interval_start + (width > 0 ? (x - x_table[interval]) / width : 0) * step;
+
+    if (slope_x(guess) >= 1e-3f)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            float slope = slope_x(guess);
+            if (slope == 0)
+                break;
+            guess -= (sample_x(guess) - x) / slope;
+        }
+        return guess;
+    }
+
+    // Too flat for Newton's method to be reliable
+    float low = interval_start;
+    float high = interval_start + step;
+    for (int i = 0; i < 20; i++)
+    {
+        guess = (low + high) / 2;
+        float error = sample_x(guess) - x;
+        if (std::abs(error) < 1e-7f)
+            break;
+        if (error > 0)
+            high = guess;
+        else
+            low = guess;
+    }
+    return guess;
+}
+
+float CubicBezier::solve(float x) const
+{
+    if (is_linear || x <= 0 || x >= 1)
+        return std::clamp(x, 0.f, 1.f);
+
+    return sample_y(find_parameter(x));
+}
+
+EasingTable::EasingTable(AnimationDefinition const& definition, size_t size) :
+    samples(std::clamp(size, min_size, max_size))
+{
+    auto const last = static_cast<float>(samples.size() - 1);
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = ease_analytic(definition, static_cast<float>(i) / last);
+}
+
+float EasingTable::sample(float t) const
+{
+    float out;
+    sample(&t, &out, 1);
+    return out;
+}
+
+void EasingTable::sample(float const* t, float* out, size_t count) const
+{
+    auto const* data = samples.data();
+    auto const last = samples.size() - 1;
+    auto const scale = static_cast<float>(last);
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = std::clamp(t[i], 0.f, 1.f) * scale;
+        auto index = std::min(static_cast<size_t>(x), last - 1);
+        float fraction = x - static_cast<float>(index);
+        out[i] = data[index] + (data[index + 1] - data[index]) * fraction;
+    }
+}
+
+float miracle::ease(AnimationDefinition const& defintion, float t)
+{
+    if (defintion.easing_table)
+        return defintion.easing_table->sample(t);
+
+    return ease_analytic(defintion, t);
+}
+
+bool miracle::is_polynomial_curve(EaseFunction function)
+{
+    switch (function)
+    {
+    case EaseFunction::linear:
+    case EaseFunction::ease_in_quad:
+    case EaseFunction::ease_out_quad:
+    case EaseFunction::ease_in_out_quad:
+    case EaseFunction::ease_in_cubic:
+    case EaseFunction::ease_out_cubic:
+    case EaseFunction::ease_in_out_cubic:
+    case EaseFunction::ease_in_quart:
+    case EaseFunction::ease_out_quart:
+    case EaseFunction::ease_in_out_quart:
+    case EaseFunction::ease_in_quint:
+    case EaseFunction::ease_out_quint:
+    case EaseFunction::ease_in_out_quint:
+    case EaseFunction::ease_in_back:
+    case EaseFunction::ease_out_back:
+    case EaseFunction::ease_in_out_back:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool miracle::same_curve(AnimationDefinition const& a, AnimationDefinition const& b)
+{
+    return a.function == b.function
+        && a.c1 == b.c1
+        && a.c2 == b.c2
+        && a.c3 == b.c3
+        && a.c4 == b.c4
+        && a.c5 == b.c5
+        && a.n1 == b.n1
+        && a.d1 == b.d1
+        && a.cubic_bezier == b.cubic_bezier
+        && a.easing_table == b.easing_table;
+}
+
+void miracle::ease_batch(AnimationDefinition const& defintion, float const* t, float* out, size_t count)
+{
+    // Polynomial curves are written once as generic lambdas, so that they can be
+    // evaluated four at a time on vectors. Curves that need powf, sinf or the
+    // piecewise bounce fall back to the scalar function.
+    if (defintion.easing_table)
+    {
+        defintion.easing_table->sample(t, out, count);
+        return;
+    }
+
+    auto const c1 = defintion.c1;
+    auto const c2 = defintion.c2;
+    auto const c3 = defintion.c3;
+    switch (defintion.function)
+    {
+    case EaseFunction::linear:
+        apply_in_lanes(t, out, count, [](auto x) { return x; });
+        break;
+    case EaseFunction::ease_in_quad:
+        apply_in_lanes(t, out, count, [](auto x) { return x * x; });
+        break;
+    case EaseFunction::ease_out_quad:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto u = 1.f - x;
+            return 1.f - u * u;
+        });
+        break;
+    case EaseFunction::ease_in_out_quad:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto u = -2.f * x + 2.f;
+            return x < 0.5f ? 2.f * x * x : 1.f - u * u / 2.f;
+        });
+        break;
+    case EaseFunction::ease_in_cubic:
+        apply_in_lanes(t, out, count, [](auto x) { return x * x * x; });
+        break;
+    case EaseFunction::ease_out_cubic:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto u = 1.f - x;
+            return 1.f - u * u * u;
+        });
+        break;
+    case EaseFunction::ease_in_out_cubic:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto u = -2.f * x + 2.f;
+            return x < 0.5f ? 4.f * x * x * x : 1.f - u * u * u / 2.f;
+        });
+        break;
+    case EaseFunction::ease_in_quart:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto x2 = x * x;
+            return x2 * x2;
+        });
+        break;
+    case EaseFunction::ease_out_quart:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto u = 1.f - x;
+            auto u2 = u * u;
+            return 1.f - u2 * u2;
+        });
+        break;
+    case EaseFunction::ease_in_out_quart:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto x2 = x * x;
+            auto u = -2.f * x + 2.f;
+            auto u2 = u * u;
+            return x < 0.5f ? 8.f * x2 * x2 : 1.f - u2 * u2 / 2.f;
+        });
+        break;
+    case EaseFunction::ease_in_quint:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto x2 = x * x;
+            return x2 * x2 * x;
+        });
+        break;
+    case EaseFunction::ease_out_quint:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto u = 1.f - x;
+            auto u2 = u * u;
+            return 1.f - u2 * u2 * u;
+        });
+        break;
+    case EaseFunction::ease_in_out_quint:
+        apply_in_lanes(t, out, count, [](auto x)
+        {
+            auto x2 = x * x;
+            auto u = -2.f * x + 2.f;
+            auto u2 = u * u;
+            return x < 0.5f ? 16.f * x2 * x2 * x : 1.f - u2 * u2 * u / 2.f;
+        });
+        break;
+    case EaseFunction::ease_in_back:
+        apply_in_lanes(t, out, count, [c1, c3](auto x) { return c3 * x * x * x - c1 * x * x; });
+        break;
+    case EaseFunction::ease_out_back:
+        apply_in_lanes(t, out, count, [c1, c3](auto x)
+        {
+            auto u = x - 1.f;
+            return 1.f + c3 * u * u * u + c1 * u * u;
+        });
+        break;
+    case EaseFunction::ease_in_out_back:
+        apply_in_lanes(t, out, count, [c2](auto x)
+        {
+            auto a = 2.f * x;
+            auto b = 2.f * x - 2.f;
+            return x < 0.5f
+                ? (a * a * ((c2 + 1.f) * a - c2)) / 2.f
+                : (b * b * ((c2 + 1.f) * b + c2) + 2.f) / 2.f;
+        });
+        break;
+    default:
+        for (size_t i = 0; i < count; i++)
+            out[i] = ease_analytic(defintion, t[i]);
+        break;
+    }
+}
@@ -0,0 +1,112 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_EASING_H
+#define MIRACLEWM_EASING_H
+
+#include "animation_defintion.h"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace miracle
+{
+
+/// A cubic bezier curve running from (0, 0) to (1, 1) through the control
+/// points (x1, y1) and (x2, y2), as in CSS. x is the progress of the
+/// animation and y is the eased value.
+///
+/// Finding y for a given x means solving the curve's cubic in x. A table of
+/// x values at evenly spaced curve parameters is computed once, so that
+/// each solve starts from a close guess and converges in a few Newton
+/// iterations, falling back to bisection where the curve is too flat.
+class CubicBezier
+{
+public:
+    /// [x1] and [x2] must be between 0 and 1, so that x only ever increases.
+    CubicBezier(float x1, float y1, float x2, float y2);
+
+    /// Returns y for progress [x].
+    [[nodiscard]] float solve(float x) const;
+
+private:
+    [[nodiscard]] float sample_x(float s) const;
+    [[nodiscard]] float sample_y(float s) const;
+    [[nodiscard]] float slope_x(float s) const;
+    [[nodiscard]] float find_parameter(float x) const;
+
+    static constexpr size_t table_size = 11;
+
+    bool is_linear;
+    float ax, bx, cx;
+    float ay, by, cy;
+    std::array<float, table_size> x_table;
+};
+
+/// The spring curve reaches 1 - (1 + k) * e^-k, which is within 0.1% of its
+/// target, at the end of the animation's duration.
+constexpr float spring_settle_factor = 9.233f;
+
+/// Samples of an ease curve taken at evenly spaced progress values, from
+/// which the curve is reconstructed by linear interpolation. This trades a
+/// small amount of accuracy for not having to evaluate the transcendental
+/// functions of curves like elastic, bounce and expo on every frame.
+class EasingTable
+{
+public:
+    /// Samples the curve of [definition] [size] times. [size] must be at
+    /// least 2, so that both ends of the curve are sampled exactly.
+    EasingTable(AnimationDefinition const& definition, size_t size);
+
+    /// Interpolates the curve at progress [t], clamped to between 0 and 1.
+    [[nodiscard]] float sample(float t) const;
+
+    /// Interpolates the curve at each of [count] progress values in [t].
+    void sample(float const* t, float* out, size_t count) const;
+    [[nodiscard]] size_t size() const { return samples.size(); }
+
+    static constexpr size_t min_size = 2;
+    static constexpr size_t max_size = 65536;
+
+private:
+    std::vector<float> samples;
+};
+
+/// Evaluates the ease function of [definition] at progress [t], where [t]
+/// runs from 0 to 1. If [definition] has an easing table, the value is
+/// interpolated from the table.
+float ease(AnimationDefinition const& definition, float t);
+
+/// Evaluates the ease function of [definition] for [count] progress values
+/// in [t], writing the results to [out].
+///
+/// The function is resolved once for the whole batch. Polynomial curves are
+/// evaluated in loops that the compiler can vectorize, while the remaining
+/// curves fall back to calling [ease] for each value.
+void ease_batch(AnimationDefinition const& definition, float const* t, float* out, size_t count);
+
+/// Returns true if [function] is a polynomial, which [ease_batch] evaluates
+/// exactly on vectors. Such curves gain nothing from an [EasingTable].
+bool is_polynomial_curve(EaseFunction function);
+
+/// Returns true if [a] and [b] describe the same ease curve, evaluated the
+/// same way, and may therefore be evaluated in the same batch.
+bool same_curve(AnimationDefinition const& a, AnimationDefinition const& b);
+
+}
+
+#endif // MIRACLEWM_EASING_H
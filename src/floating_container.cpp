@@ -54,6 +54,7 @@ mir::geometry::Rectangle FloatingContainer::get_logical_area() const
 void FloatingContainer::set_logical_area(mir::geometry::Rectangle const& rectangle)
 {
     window_controller.set_rectangle(window_, get_visible_area(), rectangle);
+    workspace_->mark_dirty();
 }
 
 mir::geometry::Rectangle FloatingContainer::get_visible_area() const
@@ -91,6 +92,7 @@ void FloatingContainer::handle_modify(miral::WindowSpecification const& modifica
 {
     auto& info = window_controller.info_for(window_);
     wm->handle_modify_window(info, modifications);
+    workspace_->mark_dirty();
 }
 
 void FloatingContainer::handle_request_move(MirInputEvent const* input_event)
@@ -122,16 +124,19 @@ void FloatingContainer::on_focus_gained()
         return;
 
     wm->advise_focus_gained(window_controller.info_for(window_));
+    workspace_->mark_dirty();
 }
 
 void FloatingContainer::on_focus_lost()
 {
     wm->advise_focus_lost(window_controller.info_for(window_));
+    workspace_->mark_dirty();
 }
 
 void FloatingContainer::on_move_to(geom::Point const& top_left)
 {
     wm->advise_move_to(window_controller.info_for(window_), top_left);
+    workspace_->mark_dirty();
 }
 
 mir::geometry::Rectangle FloatingContainer::confirm_placement(
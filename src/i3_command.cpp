@@ -16,9 +16,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 
 #include "i3_command.h"
-#include "jpcre2.h"
+#include "container.h"
+#include "regex_cache.h"
 #include "window_controller.h"
 #include "window_helpers.h"
+#include "workspace.h"
 
 #include <cstring>
 #include <ranges>
@@ -40,6 +42,9 @@ const char* WORKSPACE_STRING = "workspace";
 const char* ALL_STRING = "all";
 const char* FLOATING_STRING = "floating";
 const char* TILING_STRING = "tiling";
+const char* CON_ID_STRING = "con_id";
+const char* CON_MARK_STRING = "con_mark";
+const char* APP_ID_STRING = "app_id";
 
 inline bool try_parse_i3_scope(
     std::string_view const& view,
@@ -105,6 +110,12 @@ std::vector<I3Scope> I3Scope::parse(std::string_view const& view, int& ptr)
             next.type = I3ScopeType::urgent;
         else if (try_parse_i3_scope(view, ptr, WORKSPACE_STRING, true))
             next.type = I3ScopeType::workspace;
+        else if (try_parse_i3_scope(view, ptr, CON_ID_STRING, true))
+            next.type = I3ScopeType::con_id;
+        else if (try_parse_i3_scope(view, ptr, CON_MARK_STRING, true))
+            next.type = I3ScopeType::con_mark;
+        else if (try_parse_i3_scope(view, ptr, APP_ID_STRING, true))
+            next.type = I3ScopeType::app_id;
         else if (try_parse_i3_scope(view, ptr, ALL_STRING, false))
         {
             next.type = I3ScopeType::all;
@@ -132,7 +143,23 @@ std::vector<I3Scope> I3Scope::parse(std::string_view const& view, int& ptr)
         // If we get here, it is assumed that we need to also parse a regex
         ptr++;
         if (view[ptr] != '"')
+        {
+            // Values such as con_id=1234 may be given without quotes
+            auto start = ptr;
+            for (; ptr < view.size(); ptr++)
+            {
+                if (view[ptr] == ' ' || view[ptr] == ']')
+                    break;
+            }
+
+            if (ptr == view.size())
+                break;
+
+            next.regex = view.substr(start, ptr - start);
+            next.compiled_regex = RegexCache::get_instance().get(next.regex.value());
+            result.push_back(next);
             continue;
+        }
 
         ptr++;
         auto start = ptr;
@@ -150,6 +177,7 @@ std::vector<I3Scope> I3Scope::parse(std::string_view const& view, int& ptr)
 
         ptr++;
         next.regex = view.substr(start, ptr - start - 1);
+        next.compiled_regex = RegexCache::get_instance().get(next.regex.value());
 
         // TODO: Verify if we have a valid value here or not
         result.push_back(next);
@@ -160,24 +188,70 @@ std::vector<I3Scope> I3Scope::parse(std::string_view const& view, int& ptr)
 
 bool I3ScopedCommandList::meets_criteria(miral::Window const& window, WindowController& window_controller) const
 {
-    typedef jpcre2::select<char> jp;
-    auto container = window_controller.get_container(window);
+    return meets_criteria(window_controller.get_container(window), window_controller);
+}
+
+namespace
+{
+bool matches(I3Scope const& criteria, std::string const& value)
+{
+    return criteria.compiled_regex && criteria.compiled_regex->matches(value);
+}
+}
+
+bool I3ScopedCommandList::meets_criteria(std::shared_ptr<Container> const& container, WindowController& window_controller) const
+{
     if (!container)
         return false;
 
+    // Every criteria must match
     for (auto const& criteria : scope)
     {
         switch (criteria.type)
         {
-        case I3ScopeType::all:
-            break;
         case I3ScopeType::title:
         {
-            auto& info = window_controller.info_for(window);
-            jp::Regex re(criteria.regex.value());
-            auto const& name = info.name();
-            return re.match(name);
+            auto window = container->window();
+            if (!window || !matches(criteria, window_controller.info_for(*window).name()))
+                return false;
+            break;
+        }
+        case I3ScopeType::app_id:
+        {
+            auto window = container->window();
+            if (!window || !matches(criteria, window_controller.info_for(*window).application_id()))
+                return false;
+            break;
+        }
+        case I3ScopeType::con_id:
+        {
+            if (criteria.regex == "__focused__")
+            {
+                if (!container->is_focused())
+                    return false;
+            }
+            else if (criteria.regex != std::to_string(container->get_id()))
+                return false;
+            break;
+        }
+        case I3ScopeType::workspace:
+        {
+            auto workspace = container->get_workspace();
+            if (!workspace || !matches(criteria, std::to_string(workspace->get_workspace())))
+                return false;
+            break;
         }
+        case I3ScopeType::floating:
+            if (container->get_type() != ContainerType::floating)
+                return false;
+            break;
+        case I3ScopeType::tiling:
+            if (container->get_type() != ContainerType::leaf)
+                return false;
+            break;
+        case I3ScopeType::con_mark:
+            // Marks are not supported yet, so no container can have one
+            return false;
         default:
             break;
         }
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <miral/window.h>
 #include <miral/window_manager_tools.h>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -27,6 +28,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 namespace miracle
 {
 class WindowController;
+class CompiledRegex;
+class Container;
 
 enum class I3CommandType
 {
@@ -69,6 +72,9 @@ enum class I3ScopeType
     tiling,
     tiling_from,
 
+    /// Wayland-only, from sway
+    app_id,
+
     /// TODO: X11-only
     class_,
     /// TODO: X11-only
@@ -86,6 +92,10 @@ struct I3Scope
     I3ScopeType type = I3ScopeType::none;
     std::optional<std::string> regex;
 
+    /// [regex] compiled when the scope was parsed. Scopes with the same
+    /// pattern share the same compiled regex.
+    std::shared_ptr<CompiledRegex const> compiled_regex;
+
     /// Assumes that the provided string_view is in [] brackets
     static std::vector<I3Scope> parse(std::string_view const&, int& ptr);
 };
@@ -96,12 +106,20 @@ struct I3Command
     std::vector<std::string> arguments;
 };
 
+/// The outcome of a single command, as reported back to the IPC client.
+struct I3CommandResult
+{
+    bool success = true;
+    std::string error;
+};
+
 struct I3ScopedCommandList
 {
     std::vector<I3Command> commands;
     std::vector<I3Scope> scope;
 
     bool meets_criteria(miral::Window const&, WindowController&) const;
+    bool meets_criteria(std::shared_ptr<Container> const&, WindowController&) const;
 
     static std::vector<I3ScopedCommandList> parse(std::string_view const&);
 };
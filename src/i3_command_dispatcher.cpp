@@ -0,0 +1,38 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "i3_command_dispatcher.h"
+#include <mir/server_action_queue.h>
+
+using namespace miracle;
+
+I3CommandDispatcher::I3CommandDispatcher(
+    std::shared_ptr<mir::ServerActionQueue> const& queue,
+    Executor executor) :
+    queue { queue },
+    executor { std::move(executor) }
+{
+}
+
+void I3CommandDispatcher::dispatch(std::string_view const& command, ReplyCallback reply)
+{
+    auto command_lists = I3ScopedCommandList::parse(command);
+    queue->enqueue(this, [this, command_lists = std::move(command_lists), reply = std::move(reply)]()
+    {
+        reply(executor(command_lists));
+    });
+}
@@ -0,0 +1,61 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_I3_COMMAND_DISPATCHER_H
+#define MIRACLEWM_I3_COMMAND_DISPATCHER_H
+
+#include "i3_command.h"
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace mir
+{
+class ServerActionQueue;
+}
+
+namespace miracle
+{
+
+/// Hands i3 commands received over IPC to the server thread and reports
+/// their results back to the sender.
+///
+/// Every message is parsed into its own list of commands, which is then moved
+/// into the action that runs it. Messages that arrive before earlier ones have
+/// run are therefore queued behind them instead of replacing them.
+class I3CommandDispatcher
+{
+public:
+    using Executor = std::function<std::vector<I3CommandResult>(std::vector<I3ScopedCommandList> const&)>;
+    using ReplyCallback = std::function<void(std::vector<I3CommandResult> const&)>;
+
+    I3CommandDispatcher(std::shared_ptr<mir::ServerActionQueue> const&, Executor);
+
+    /// Parses [command] and queues it to run on the server thread. [reply] is
+    /// called on the server thread with one result per command once they have
+    /// all run. [command] must be null-terminated.
+    void dispatch(std::string_view const& command, ReplyCallback reply);
+
+private:
+    std::shared_ptr<mir::ServerActionQueue> queue;
+    Executor executor;
+};
+
+}
+
+#endif // MIRACLEWM_I3_COMMAND_DISPATCHER_H
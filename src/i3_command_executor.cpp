@@ -22,15 +22,35 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "leaf_container.h"
 #include "parent_container.h"
 #include "policy.h"
+#include "regex_cache.h"
 #include "window_controller.h"
 #include "window_helpers.h"
 
 #define MIR_LOG_COMPONENT "miracle"
 #include <mir/log.h>
-#include <miral/application_info.h>
+#include <algorithm>
+#include <charconv>
+#include <cstdarg>
 
 using namespace miracle;
 
+namespace
+{
+/// Logs the error and returns it so that it can be reported to the IPC client.
+__attribute__((format(printf, 1, 2)))
+I3CommandResult fail(char const* format, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    mir::log_warning("%s", buffer);
+    return { false, buffer };
+}
+}
+
 I3CommandExecutor::I3CommandExecutor(
     miracle::Policy& policy,
     WorkspaceManager& workspace_manager,
@@ -45,58 +65,157 @@ I3CommandExecutor::I3CommandExecutor(
 {
 }
 
-void I3CommandExecutor::process(miracle::I3ScopedCommandList const& command_list)
+void I3CommandExecutor::process(miracle::I3ScopedCommandList const& command_list, std::vector<I3CommandResult>& results)
 {
     for (auto const& command : command_list.commands)
     {
         switch (command.type)
         {
         case I3CommandType::exec:
-            process_exec(command, command_list);
+            results.push_back(process_exec(command, command_list));
             break;
         case I3CommandType::split:
-            process_split(command, command_list);
+            results.push_back(process_split(command, command_list));
             break;
         case I3CommandType::focus:
-            process_focus(command, command_list);
+            results.push_back(process_focus(command, command_list));
             break;
         case I3CommandType::move:
-            process_move(command, command_list);
+            results.push_back(process_move(command, command_list));
             break;
         case I3CommandType::sticky:
-            process_sticky(command, command_list);
+            results.push_back(process_sticky(command, command_list));
             break;
         default:
+            results.push_back(fail("Unsupported command type: %d", (int)command.type));
             break;
         }
     }
 }
 
-miral::Window I3CommandExecutor::get_window_meeting_criteria(I3ScopedCommandList const& command_list)
+std::vector<I3CommandResult> I3CommandExecutor::process(std::vector<I3ScopedCommandList> const& command_lists)
 {
-    miral::Window result;
-    tools.find_application([&](miral::ApplicationInfo const& info)
+    std::vector<I3CommandResult> results;
+    WindowControllerBatch batch { window_controller };
+    for (auto const& command_list : command_lists)
+        process(command_list, results);
+    return results;
+}
+
+bool I3CommandExecutor::collect_candidates(
+    I3ScopedCommandList const& command_list, std::vector<std::shared_ptr<Container>>& candidates)
+{
+    auto const& index = policy.get_window_index();
+    auto const add_all = [&](std::vector<uint64_t> const& ids)
+    {
+        for (auto id : ids)
+        {
+            if (auto container = index.get(id))
+                candidates.push_back(container);
+        }
+    };
+
+    // Use the first criteria that can be answered with a lookup. The candidates
+    // that it produces are still checked against every criteria afterwards.
+    for (auto const& criteria : command_list.scope)
     {
-        for (auto const& window : info.windows())
+        if (!criteria.regex)
+            continue;
+
+        auto const& value = criteria.regex.value();
+        auto const& exact_match = criteria.compiled_regex ? criteria.compiled_regex->get_exact_match() : std::nullopt;
+        switch (criteria.type)
+        {
+        case I3ScopeType::con_id:
         {
-            if (command_list.meets_criteria(window, window_controller))
+            if (value == "__focused__")
             {
-                result = window;
+                if (auto active = policy.get_state().active)
+                    candidates.push_back(active);
                 return true;
             }
+
+            uint64_t id = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), id);
+            if (ec == std::errc() && ptr == value.data() + value.size())
+            {
+                if (auto container = index.get(id))
+                    candidates.push_back(container);
+            }
+            return true;
         }
+        case I3ScopeType::title:
+            if (!exact_match)
+                break;
+            add_all(index.find_by_title(exact_match.value()));
+            return true;
+        case I3ScopeType::app_id:
+            if (!exact_match)
+                break;
+            add_all(index.find_by_app_id(exact_match.value()));
+            return true;
+        case I3ScopeType::workspace:
+        {
+            if (value.empty() || !std::all_of(value.begin(), value.end(), ::isdigit))
+                break;
+
+            // A number too large to parse cannot name a workspace either
+            int key = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), key);
+            if (ec != std::errc() || ptr != value.data() + value.size()
+                || key < 0 || key >= WorkspaceManager::NUM_WORKSPACES)
+                return true;
 
-        return false;
-    });
+            auto const& output = workspace_manager.get_workspaces()[key];
+            if (!output)
+                return true;
+
+            for (auto const& workspace : output->get_workspaces())
+            {
+                if (workspace->get_workspace() == key)
+                    workspace->for_each_window([&](std::shared_ptr<Container> const& container)
+                    {
+                        candidates.push_back(container);
+                    });
+            }
+            return true;
+        }
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+std::vector<std::shared_ptr<Container>> I3CommandExecutor::get_containers_meeting_criteria(I3ScopedCommandList const& command_list)
+{
+    std::vector<std::shared_ptr<Container>> candidates;
+    if (!collect_candidates(command_list, candidates))
+    {
+        auto const& index = policy.get_window_index();
+        candidates.reserve(index.size());
+        index.for_each([&](uint64_t id)
+        {
+            if (auto container = index.get(id))
+                candidates.push_back(container);
+        });
+    }
+
+    std::vector<std::shared_ptr<Container>> result;
+    for (auto const& container : candidates)
+    {
+        if (command_list.meets_criteria(container, window_controller))
+            result.push_back(container);
+    }
     return result;
 }
 
-void I3CommandExecutor::process_exec(miracle::I3Command const& command, miracle::I3ScopedCommandList const& command_list)
+I3CommandResult I3CommandExecutor::process_exec(miracle::I3Command const& command, miracle::I3ScopedCommandList const& command_list)
 {
     if (command.arguments.empty())
     {
-        mir::log_warning("process_exec: no arguments were supplied");
-        return;
+        return fail("process_exec: no arguments were supplied");
     }
 
     size_t arg_index = 0;
@@ -109,20 +228,19 @@ void I3CommandExecutor::process_exec(miracle::I3Command const& command, miracle:
 
     if (arg_index >= command.arguments.size())
     {
-        mir::log_warning("process_exec: argument does not have a command to run");
-        return;
+        return fail("process_exec: argument does not have a command to run");
     }
 
     StartupApp app { command.arguments[arg_index], false, no_startup_id };
     launcher.launch(app);
+    return {};
 }
 
-void I3CommandExecutor::process_split(miracle::I3Command const& command, miracle::I3ScopedCommandList const& command_list)
+I3CommandResult I3CommandExecutor::process_split(miracle::I3Command const& command, miracle::I3ScopedCommandList const& command_list)
 {
     if (command.arguments.empty())
     {
-        mir::log_warning("process_split: no arguments were supplied");
-        return;
+        return fail("process_split: no arguments were supplied");
     }
 
     if (command.arguments.front() == "vertical")
@@ -139,27 +257,31 @@ void I3CommandExecutor::process_split(miracle::I3Command const& command, miracle
     }
     else
     {
-        mir::log_warning("process_split: unknown argument %s", command.arguments.front().c_str());
-        return;
+        return fail("process_split: unknown argument %s", command.arguments.front().c_str());
     }
+
+    return {};
 }
 
-void I3CommandExecutor::process_focus(I3Command const& command, I3ScopedCommandList const& command_list)
+I3CommandResult I3CommandExecutor::process_focus(I3Command const& command, I3ScopedCommandList const& command_list)
 {
     // https://i3wm.org/docs/userguide.html#_focusing_moving_containers
     if (command.arguments.empty())
     {
         if (command_list.scope.empty())
         {
-            mir::log_warning("Focus command expected scope but none was provided");
-            return;
+            return fail("Focus command expected scope but none was provided");
         }
 
-        auto window = get_window_meeting_criteria(command_list);
-        if (window)
-            window_controller.select_active_window(window);
+        // As in i3, every match is focused in turn, which leaves the last one focused
+        auto containers = get_containers_meeting_criteria(command_list);
+        if (!containers.empty())
+        {
+            if (auto window = containers.back()->window())
+                window_controller.select_active_window(*window);
+        }
 
-        return;
+        return {};
     }
 
     auto const& arg = command.arguments.front();
@@ -167,14 +289,12 @@ void I3CommandExecutor::process_focus(I3Command const& command, I3ScopedCommandL
     {
         if (command_list.scope.empty())
         {
-            mir::log_warning("Focus 'workspace' command expected scope but none was provided");
-            return;
+            return fail("Focus 'workspace' command expected scope but none was provided");
         }
 
-        auto window = get_window_meeting_criteria(command_list);
-        auto container = window_controller.get_container(window);
-        if (container)
-            workspace_manager.request_focus(container->get_workspace()->get_workspace());
+        auto containers = get_containers_meeting_criteria(command_list);
+        if (!containers.empty() && containers.back()->get_workspace())
+            workspace_manager.request_focus(containers.back()->get_workspace()->get_workspace());
     }
     else if (arg == "left")
         policy.try_select(Direction::left);
@@ -185,23 +305,22 @@ void I3CommandExecutor::process_focus(I3Command const& command, I3ScopedCommandL
     else if (arg == "down")
         policy.try_select(Direction::down);
     else if (arg == "parent")
-        mir::log_warning("'focus parent' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
+        return fail("'focus parent' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
     else if (arg == "child")
-        mir::log_warning("'focus child' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
+        return fail("'focus child' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
     else if (arg == "prev")
     {
         auto active_window = tools.active_window();
         if (!active_window)
-            return;
+            return {};
 
         auto container = window_controller.get_container(active_window);
         if (!container)
-            return;
+            return {};
 
         if (container->get_type() != ContainerType::leaf)
         {
-            mir::log_warning("Cannot focus prev when a tiling window is not selected");
-            return;
+            return fail("Cannot focus prev when a tiling window is not selected");
         }
 
         if (auto parent = Container::as_parent(container->get_parent().lock()))
@@ -218,16 +337,15 @@ void I3CommandExecutor::process_focus(I3Command const& command, I3ScopedCommandL
     {
         auto active_window = tools.active_window();
         if (!active_window)
-            return;
+            return {};
 
         auto container = window_controller.get_container(active_window);
         if (!container)
-            return;
+            return {};
 
         if (container->get_type() != ContainerType::leaf)
         {
-            mir::log_warning("Cannot focus prev when a tiling window is not selected");
-            return;
+            return fail("Cannot focus prev when a tiling window is not selected");
         }
 
         if (auto parent = Container::as_parent(container->get_parent().lock()))
@@ -241,13 +359,15 @@ void I3CommandExecutor::process_focus(I3Command const& command, I3ScopedCommandL
         }
     }
     else if (arg == "floating")
-        mir::log_warning("'focus floating' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
+        return fail("'focus floating' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
     else if (arg == "tiling")
-        mir::log_warning("'focus tiling' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
+        return fail("'focus tiling' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
     else if (arg == "mode_toggle")
-        mir::log_warning("'focus mode_toggle' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
+        return fail("'focus mode_toggle' is not supported, see https://github.com/mattkae/miracle-wm/issues/117"); // TODO
     else if (arg == "output")
-        mir::log_warning("'focus output' is not supported, see https://github.com/canonical/mir/issues/3357"); // TODO
+        return fail("'focus output' is not supported, see https://github.com/canonical/mir/issues/3357"); // TODO
+
+    return {};
 }
 
 namespace
@@ -281,20 +401,18 @@ bool parse_move_distance(std::vector<std::string> const& arguments, int& index,
 }
 }
 
-void I3CommandExecutor::process_move(I3Command const& command, I3ScopedCommandList const& command_list)
+I3CommandResult I3CommandExecutor::process_move(I3Command const& command, I3ScopedCommandList const& command_list)
 {
     auto active_output = policy.get_active_output();
     if (!active_output)
     {
-        mir::log_warning("process_move: output is not set");
-        return;
+        return fail("process_move: output is not set");
     }
 
     // https://i3wm.org/docs/userguide.html#_focusing_moving_containers
     if (command.arguments.empty())
     {
-        mir::log_warning("process_move: move command expects arguments");
-        return;
+        return fail("process_move: move command expects arguments");
     }
 
     int index = 0;
@@ -325,8 +443,7 @@ void I3CommandExecutor::process_move(I3Command const& command, I3ScopedCommandLi
     {
         if (command.arguments.size() < 2)
         {
-            mir::log_error("process_move: move position expected a third argument");
-            return;
+            return fail("process_move: move position expected a third argument");
         }
 
         auto const& arg1 = command.arguments[index++];
@@ -350,19 +467,17 @@ void I3CommandExecutor::process_move(I3Command const& command, I3ScopedCommandLi
 
             if (!parse_move_distance(command.arguments, index, total_size, move_distance_x))
             {
-                mir::log_error("process_move: move position <x> <y>: unable to parse x");
-                return;
+                return fail("process_move: move position <x> <y>: unable to parse x");
             }
 
             if (!parse_move_distance(command.arguments, index, total_size, move_distance_y))
             {
-                mir::log_error("process_move: move position <x> <y>: unable to parse y");
-                return;
+                return fail("process_move: move position <x> <y>: unable to parse y");
             }
 
             policy.try_move_to(move_distance_x, move_distance_y);
         }
-        return;
+        return {};
     }
     else if (arg0 == "absolute")
     {
@@ -370,14 +485,12 @@ void I3CommandExecutor::process_move(I3Command const& command, I3ScopedCommandLi
         auto const& arg2 = command.arguments[index++];
         if (arg1 != "position")
         {
-            mir::log_error("process_move: move [absolute] ... expected 'position' as the third argument");
-            return;
+            return fail("process_move: move [absolute] ... expected 'position' as the third argument");
         }
 
         if (arg2 != "center")
         {
-            mir::log_error("process_move: move absolute position ... expected 'center' as the third argument");
-            return;
+            return fail("process_move: move absolute position ... expected 'center' as the third argument");
         }
 
         float x = 0, y = 0;
@@ -396,7 +509,7 @@ void I3CommandExecutor::process_move(I3Command const& command, I3ScopedCommandLi
         float x_pos = x / 2.f - (float)active->get_visible_area().size.width.as_int() / 2.f;
         float y_pos = y / 2.f - (float)active->get_visible_area().size.height.as_int() / 2.f;
         policy.try_move_to((int)x_pos, (int)y_pos);
-        return;
+        return {};
     }
 
     if (direction < Direction::MAX)
@@ -407,14 +520,15 @@ void I3CommandExecutor::process_move(I3Command const& command, I3ScopedCommandLi
         else
             policy.try_move(direction);
     }
+
+    return {};
 }
 
-void I3CommandExecutor::process_sticky(I3Command const& command, I3ScopedCommandList const& command_list)
+I3CommandResult I3CommandExecutor::process_sticky(I3Command const& command, I3ScopedCommandList const& command_list)
 {
     if (command.arguments.empty())
     {
-        mir::log_warning("process_sticky: expects arguments");
-        return;
+        return fail("process_sticky: expects arguments");
     }
 
     auto const& arg0 = command.arguments[0];
@@ -425,5 +539,7 @@ void I3CommandExecutor::process_sticky(I3Command const& command, I3ScopedCommand
     else if (arg0 == "toggle")
         policy.toggle_pinned_to_workspace();
     else
-        mir::log_warning("process_sticky: unknown arguments: %s", arg0.c_str());
-}
\ No newline at end of file
+        return fail("process_sticky: unknown arguments: %s", arg0.c_str());
+
+    return {};
+}
@@ -28,6 +28,7 @@ class Policy;
 class WorkspaceManager;
 class AutoRestartingLauncher;
 class WindowController;
+class Container;
 
 /// Processes all commands coming from i3 IPC. This class is mostly for organizational
 /// purposes, as a lot of logic is associated with processing these operations.
@@ -40,7 +41,11 @@ public:
         miral::WindowManagerTools const&,
         AutoRestartingLauncher&,
         WindowController&);
-    void process(I3ScopedCommandList const&);
+    /// Processes every command list as a single transaction. Window geometry
+    /// changes made by the commands are coalesced and committed once, after
+    /// the last command has run.
+    /// Returns one result per command, in the order the commands were given.
+    std::vector<I3CommandResult> process(std::vector<I3ScopedCommandList> const&);
 
 private:
     Policy& policy;
@@ -49,12 +54,18 @@ private:
     AutoRestartingLauncher& launcher;
     WindowController& window_controller;
 
-    miral::Window get_window_meeting_criteria(I3ScopedCommandList const&);
-    void process_exec(I3Command const&, I3ScopedCommandList const&);
-    void process_split(I3Command const&, I3ScopedCommandList const&);
-    void process_focus(I3Command const&, I3ScopedCommandList const&);
-    void process_move(I3Command const&, I3ScopedCommandList const&);
-    void process_sticky(I3Command const&, I3ScopedCommandList const&);
+    /// Returns every container that meets the criteria of [command_list].
+    std::vector<std::shared_ptr<Container>> get_containers_meeting_criteria(I3ScopedCommandList const&);
+
+    /// Narrows down the containers that could meet the criteria of [command_list] using
+    /// the [WindowIndex]. Returns false if no criteria could be used to narrow them down.
+    bool collect_candidates(I3ScopedCommandList const&, std::vector<std::shared_ptr<Container>>& candidates);
+    void process(I3ScopedCommandList const&, std::vector<I3CommandResult>& results);
+    I3CommandResult process_exec(I3Command const&, I3ScopedCommandList const&);
+    I3CommandResult process_split(I3Command const&, I3ScopedCommandList const&);
+    I3CommandResult process_focus(I3Command const&, I3ScopedCommandList const&);
+    I3CommandResult process_move(I3Command const&, I3ScopedCommandList const&);
+    I3CommandResult process_sticky(I3Command const&, I3ScopedCommandList const&);
 };
 
 } // miracle
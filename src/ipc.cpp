@@ -18,15 +18,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIR_LOG_COMPONENT "miracle_ipc"
 
 #include "ipc.h"
+#include "floating_container.h"
 #include "i3_command_executor.h"
+#include "json_writer.h"
 #include "miracle_config.h"
 #include "output.h"
+#include "parent_container.h"
 #include "policy.h"
+#include "tiling_window_tree.h"
 #include "version.h"
+#include "window_tools_accessor.h"
 
 #include <fcntl.h>
 #include <mir/log.h>
+#include <miral/window_info.h>
 #include <nlohmann/json.hpp>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -35,9 +42,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 using json = nlohmann::json;
 using namespace miracle;
 
-static const char ipc_magic[] = { 'i', '3', '-', 'i', 'p', 'c' };
-
-#define IPC_HEADER_SIZE (sizeof(ipc_magic) + 8)
+#define IPC_HEADER_SIZE IpcFrame::header_size
 #define event_mask(ev) (1 << (ev & 0x7F))
 
 namespace
@@ -70,122 +75,169 @@ struct sockaddr_un* ipc_user_sockaddr()
     return ipc_sockaddr;
 }
 
-json workspace_to_json(std::shared_ptr<Output> const& screen, int key)
+void write_rect(JsonWriter& writer, geom::Rectangle const& area)
 {
-    bool is_focused = screen->get_active_workspace_num() == key;
-    auto area = screen->get_workspace_rectangle(key);
+    writer.begin_object()
+        .field("x", area.top_left.x.as_int())
+        .field("y", area.top_left.y.as_int())
+        .field("width", area.size.width.as_int())
+        .field("height", area.size.height.as_int())
+        .end_object();
+}
 
-    return {
-        { "num",     Workspace::workspace_to_number(key) },
-        { "id",      key                                 },
-        { "type",    "workspace"                         },
-        { "name",    std::to_string(key)                 },
-        { "visible", screen->is_active() && is_focused   },
-        { "focused", screen->is_active() && is_focused   },
-        { "urgent",  false                               },
-        { "output",  screen->get_output().name()         },
-        { "rect",    {
-                      { "x", area.top_left.x.as_int() },
-                      { "y", area.top_left.y.as_int() },
-                      { "width", area.size.width.as_int() },
-                      { "height", area.size.height.as_int() },
-                  }                     }
-    };
+char const* to_layout_string(NodeLayoutDirection direction)
+{
+    switch (direction)
+    {
+    case NodeLayoutDirection::horizontal:
+        return "splith";
+    case NodeLayoutDirection::vertical:
+        return "splitv";
+    default:
+        return "none";
+    }
 }
 
-json output_to_json(std::shared_ptr<Output> const& output)
+char const* to_orientation_string(NodeLayoutDirection direction)
 {
-    auto area = output->get_area();
-    auto miral_output = output->get_output();
-    return {
-        { "id",     miral_output.id()   },
-        { "name",   miral_output.name() },
-        { "layout", "output"            },
-        { "rect",   {
-                      { "x", area.top_left.x.as_int() },
-                      { "y", area.top_left.y.as_int() },
-                      { "width", area.size.width.as_int() },
-                      { "height", area.size.height.as_int() },
-                  }    }
-    };
+    switch (direction)
+    {
+    case NodeLayoutDirection::horizontal:
+        return "horizontal";
+    case NodeLayoutDirection::vertical:
+        return "vertical";
+    default:
+        return "none";
+    }
 }
 
-json outputs_to_json(std::vector<std::shared_ptr<Output>> const& outputs)
+/// Writes [container] and all of its descendants as i3 "con" nodes.
+void write_container(JsonWriter& writer, std::shared_ptr<Container> const& container)
 {
-    json outputs_json;
-    for (auto const& output : outputs)
+    writer.begin_object()
+        .field("id", container->get_id())
+        .field("type", container->get_type() == ContainerType::floating ? "floating_con" : "con")
+        .field("focused", container->is_focused())
+        .field("fullscreen_mode", container->is_fullscreen() ? 1 : 0)
+        .key("rect");
+    write_rect(writer, container->get_visible_area());
+
+    if (auto parent = Container::as_parent(container))
+    {
+        writer.key("name")
+            .null()
+            .field("layout", to_layout_string(parent->get_direction()))
+            .field("orientation", to_orientation_string(parent->get_direction()))
+            .key("nodes")
+            .begin_array();
+        for (auto const& node : parent->get_sub_nodes())
+            write_container(writer, node);
+        writer.end_array();
+    }
+    else
     {
-        json workspaces;
-        for (auto const& workspace : output->get_workspaces())
+        writer.key("name");
+        auto window = container->window();
+        if (window && *window)
         {
-            workspaces.push_back(workspace_to_json(output, workspace->get_workspace()));
+            auto& info = WindowToolsAccessor::get_instance().get_tools().info_for(*window);
+            writer.value(info.name())
+                .field("app_id", info.application_id());
         }
+        else
+            writer.null();
 
-        auto area = output->get_area();
-        auto miral_output = output->get_output();
-        outputs_json.push_back({
-            { "id",     miral_output.id()    },
-            { "name",   miral_output.name()  },
-            { "layout", "output"             },
-            { "rect",   {
-                          { "x", area.top_left.x.as_int() },
-                          { "y", area.top_left.y.as_int() },
-                          { "width", area.size.width.as_int() },
-                          { "height", area.size.height.as_int() },
-                      } },
-            { "nodes",  workspaces           }
-        });
+        writer.field("layout", "none")
+            .field("orientation", "none")
+            .key("nodes")
+            .begin_array()
+            .end_array();
     }
 
-    auto area = outputs[0]->get_area();
-    json root = {
-        { "id",    0                                                                                                                                                        },
-        { "name",  "root"                                                                                                                                                   },
-        { "rect",  { { "x", area.top_left.x.as_int() }, { "y", area.top_left.y.as_int() }, { "width", area.size.width.as_int() }, { "height", area.size.height.as_int() } } },
-        { "nodes", outputs_json                                                                                                                                             }
-    };
-    return root;
+    writer.key("floating_nodes").begin_array().end_array();
+    writer.end_object();
+}
+
+void write_workspace(JsonWriter& writer, std::shared_ptr<Output> const& screen, int key, Workspace const* workspace = nullptr)
+{
+    bool is_focused = screen->get_active_workspace_num() == key;
+    auto area = screen->get_workspace_rectangle(key);
+
+    writer.begin_object()
+        .field("num", Workspace::workspace_to_number(key))
+        .field("id", key)
+        .field("type", "workspace")
+        .field("name", std::to_string(key))
+        .field("visible", screen->is_active() && is_focused)
+        .field("focused", screen->is_active() && is_focused)
+        .field("urgent", false)
+        .field("output", screen->get_output().name())
+        .key("rect");
+    write_rect(writer, area);
+
+    // The containers are only written out when the whole tree is requested
+    if (workspace)
+    {
+        auto const& root = workspace->get_tree()->get_root();
+        writer.field("layout", to_layout_string(root->get_direction()))
+            .field("orientation", to_orientation_string(root->get_direction()))
+            .key("nodes")
+            .begin_array();
+        for (auto const& node : root->get_sub_nodes())
+            write_container(writer, node);
+        writer.end_array();
+
+        writer.key("floating_nodes").begin_array();
+        for (auto const& floating : workspace->get_floating_windows())
+            write_container(writer, floating);
+        writer.end_array();
+    }
+
+    writer.end_object();
+}
+
+/// Writes the members of an output object, leaving the object open so that
+/// the caller may add to it.
+void write_output_fields(JsonWriter& writer, std::shared_ptr<Output> const& output)
+{
+    auto area = output->get_area();
+    auto miral_output = output->get_output();
+    writer.field("id", miral_output.id())
+        .field("name", miral_output.name())
+        .field("layout", "output")
+        .key("rect");
+    write_rect(writer, area);
 }
 
-json mode_to_json(WindowManagerMode mode)
+void write_mode(JsonWriter& writer, WindowManagerMode mode)
 {
     switch (mode)
     {
     case WindowManagerMode::normal:
-        return {
-            { "name", "default" }
-        };
+        writer.begin_object().field("name", "default").end_object();
+        break;
     case WindowManagerMode::resizing:
-        return {
-            { "name", "resize" }
-        };
+        writer.begin_object().field("name", "resize").end_object();
+        break;
     default:
-    {
         mir::fatal_error("handle_command: unknown binding state: %d", (int)mode);
-        return {};
-    }
+        break;
     }
 }
 
-json mode_event_to_json(WindowManagerMode mode)
+void write_mode_event(JsonWriter& writer, WindowManagerMode mode)
 {
     switch (mode)
     {
-        case WindowManagerMode::normal:
-            return {
-            { "change", "default" },
-            { "pango_markup", true }
-            };
-        case WindowManagerMode::resizing:
-            return {
-            { "change", "resize" },
-            { "pango_markup", true }
-            };
-        default:
-        {
-            mir::fatal_error("handle_command: unknown binding state: %d", (int)mode);
-            return {};
-        }
+    case WindowManagerMode::normal:
+        writer.begin_object().field("change", "default").field("pango_markup", true).end_object();
+        break;
+    case WindowManagerMode::resizing:
+        writer.begin_object().field("change", "resize").field("pango_markup", true).end_object();
+        break;
+    default:
+        mir::fatal_error("handle_command: unknown binding state: %d", (int)mode);
+        break;
     }
 }
 }
@@ -198,8 +250,12 @@ Ipc::Ipc(miral::MirRunner& runner,
     std::shared_ptr<MiracleConfig> const& config) :
     workspace_manager { workspace_manager },
     policy { policy },
-    queue { queue },
-    executor { executor },
+    dispatcher {
+        queue,
+        [&executor](std::vector<I3ScopedCommandList> const& command_lists)
+    {
+        return executor.process(command_lists);
+    } },
     config { config }
 {
     auto ipc_socket_raw = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -244,6 +300,31 @@ Ipc::Ipc(miral::MirRunner& runner,
     setenv("I3SOCK", ipc_sockaddr->sun_path, 1);
     setenv("SWAYSOCK", ipc_sockaddr->sun_path, 1);
 
+    auto write_epoll_raw = epoll_create1(EPOLL_CLOEXEC);
+    if (write_epoll_raw == -1)
+    {
+        mir::log_error("Unable to create epoll for IPC writes");
+        exit(1);
+    }
+
+    write_epoll = mir::Fd { write_epoll_raw };
+    write_epoll_handle = runner.register_fd_handler(write_epoll, [this](int)
+    {
+        int const max_events = 16;
+        epoll_event events[max_events];
+        auto const count = epoll_wait(write_epoll, events, max_events, 0);
+        for (int i = 0; i < count; i++)
+        {
+            // Clients are looked up each time, as handling one may disconnect it
+            auto it = std::find_if(clients.begin(), clients.end(), [&](IpcClient const& client)
+            {
+                return client.id == events[i].data.u64;
+            });
+            if (it != clients.end())
+                handle_writeable(*it);
+        }
+    });
+
     ipc_socket = mir::Fd { ipc_socket_raw };
     socket_handle = runner.register_fd_handler(ipc_socket, [&](int fd)
     {
@@ -272,6 +353,7 @@ Ipc::Ipc(miral::MirRunner& runner,
 
         auto mir_fd = mir::Fd { client_fd };
         clients.push_back({ mir_fd,
+            next_client_id++,
             runner.register_fd_handler(mir_fd, [this](int fd)
         {
             auto& client = get_client(fd);
@@ -337,41 +419,30 @@ Ipc::Ipc(miral::MirRunner& runner,
 
 void Ipc::on_created(std::shared_ptr<Output> const& info, int key)
 {
-    json j = {
-        { "change", "init" },
-        { "old", nullptr },
-        { "current", workspace_to_json(info, key) }
-    };
-
-    auto serialized_value = to_string(j);
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_WORKSPACE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_WORKSPACE, serialized_value);
-    }
+    std::string payload;
+    JsonWriter writer(payload);
+    writer.begin_object()
+        .field("change", "init")
+        .key("old")
+        .null()
+        .key("current");
+    write_workspace(writer, info, key);
+    writer.end_object();
+
+    broadcast(IPC_EVENT_WORKSPACE, std::move(payload));
 }
 
 void Ipc::on_removed(std::shared_ptr<Output> const& screen, int key)
 {
-    json j = {
-        { "change", "empty" },
-        { "current", workspace_to_json(screen, key) }
-    };
-
-    auto serialized_value = to_string(j);
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_WORKSPACE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_WORKSPACE, serialized_value);
-    }
+    std::string payload;
+    JsonWriter writer(payload);
+    writer.begin_object()
+        .field("change", "empty")
+        .key("current");
+    write_workspace(writer, screen, key);
+    writer.end_object();
+
+    broadcast(IPC_EVENT_WORKSPACE, std::move(payload));
 }
 
 void Ipc::on_focused(
@@ -380,40 +451,29 @@ void Ipc::on_focused(
     std::shared_ptr<Output> const& current,
     int current_key)
 {
-    json j = {
-        { "change", "focus" },
-        { "current", workspace_to_json(current, current_key) }
-    };
-
+    std::string payload;
+    JsonWriter writer(payload);
+    writer.begin_object()
+        .field("change", "focus")
+        .key("current");
+    write_workspace(writer, current, current_key);
+
+    writer.key("old");
     if (previous)
-        j["old"] = workspace_to_json(previous, previous_key);
+        write_workspace(writer, previous, previous_key);
     else
-        j["old"] = nullptr;
+        writer.null();
+    writer.end_object();
 
-    auto serialized_value = to_string(j);
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_WORKSPACE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_WORKSPACE, serialized_value);
-    }
+    broadcast(IPC_EVENT_WORKSPACE, std::move(payload));
 }
 
 void Ipc::on_changed(WindowManagerMode mode)
 {
-    auto response = to_string(mode_event_to_json(mode));
-    for (auto& client : clients)
-    {
-        if ((client.subscribed_events & event_mask(IPC_EVENT_MODE)) == 0)
-        {
-            continue;
-        }
-
-        send_reply(client, IPC_EVENT_MODE, response);
-    }
+    std::string payload;
+    JsonWriter writer(payload);
+    write_mode_event(writer, mode);
+    broadcast(IPC_EVENT_MODE, std::move(payload));
 }
 
 Ipc::IpcClient& Ipc::get_client(int fd)
@@ -435,6 +495,7 @@ void Ipc::disconnect(Ipc::IpcClient& client)
     });
     if (it != clients.end())
     {
+        wait_to_write(*it, false);
         shutdown(client.client_fd, SHUT_RDWR);
         mir::log_info("Disconnected client: %d", (int)client.client_fd);
         clients.erase(it);
@@ -473,41 +534,43 @@ void Ipc::handle_command(miracle::Ipc::IpcClient& client, uint32_t payload_lengt
     {
     case IPC_COMMAND:
     {
-        auto result = parse_i3_command(std::string_view(buf));
-        if (result)
+        // The reply is sent once the commands have actually run, so that it
+        // can report whether each of them succeeded
+        dispatcher.dispatch(std::string_view(buf), [this, fd = (int)client.client_fd, id = client.id](
+                                                       std::vector<I3CommandResult> const& results)
         {
-            const std::string msg = "[{\"success\": true}]";
-            send_reply(client, payload_type, msg);
-        }
-        else
-        {
-            const std::string msg = "[{\"success\": false, \"parse_error\": true}]";
-            send_reply(client, payload_type, msg);
-        }
+            send_command_results(fd, id, results);
+        });
         break;
     }
     case IPC_GET_WORKSPACES:
     {
-        json j = json::array();
+        std::string payload;
+        JsonWriter writer(payload);
+        writer.begin_array();
         for (int i = 0; i < WorkspaceManager::NUM_WORKSPACES; i++)
         {
             auto workspace = workspace_manager.get_workspaces()[i];
             if (workspace)
-                j.push_back(workspace_to_json(workspace, i));
+                write_workspace(writer, workspace, i);
         }
-        auto json_string = to_string(j);
-        send_reply(client, payload_type, json_string);
+        writer.end_array();
+        send_reply(client, payload_type, std::move(payload));
         break;
     }
     case IPC_GET_OUTPUTS:
     {
-        json j = json::array();
+        std::string payload;
+        JsonWriter writer(payload);
+        writer.begin_array();
         for (auto const& output : policy.get_output_list())
         {
-            j.push_back(output_to_json(output));
+            writer.begin_object();
+            write_output_fields(writer, output);
+            writer.end_object();
         }
-        auto json_string = to_string(j);
-        send_reply(client, payload_type, json_string);
+        writer.end_array();
+        send_reply(client, payload_type, std::move(payload));
         break;
     }
     case IPC_SUBSCRIBE:
@@ -545,34 +608,35 @@ void Ipc::handle_command(miracle::Ipc::IpcClient& client, uint32_t payload_lengt
     }
     case IPC_GET_TREE:
     {
-        auto json_string = to_string(outputs_to_json(policy.get_output_list()));
-        send_reply(client, payload_type, json_string);
+        send_frame(client, get_tree());
         return;
     }
     case IPC_GET_VERSION:
     {
-        json response = {
-            { "major",                   MIRACLE_WM_MAJOR       },
-            { "minor",                   MIRACLE_WM_MINOR       },
-            { "patch",                   MIRACLE_WM_PATCH       },
-            { "human_readable",          MIRACLE_VERSION_STRING },
-            { "loaded_config_file_name", config->get_filename() }
-        };
-        send_reply(client, payload_type, to_string(response));
+        std::string payload;
+        JsonWriter writer(payload);
+        writer.begin_object()
+            .field("major", MIRACLE_WM_MAJOR)
+            .field("minor", MIRACLE_WM_MINOR)
+            .field("patch", MIRACLE_WM_PATCH)
+            .field("human_readable", MIRACLE_VERSION_STRING)
+            .field("loaded_config_file_name", config->get_filename())
+            .end_object();
+        send_reply(client, payload_type, std::move(payload));
         return;
     }
     case IPC_GET_BINDING_MODES:
     {
-        json response;
-        response.push_back("default");
-        response.push_back("resize");
-        send_reply(client, payload_type, to_string(response));
+        send_reply(client, payload_type, "[\"default\",\"resize\"]");
         return;
     }
     case IPC_GET_BINDING_STATE:
     {
         auto const& state = policy.get_state();
-        send_reply(client, payload_type, to_string(mode_to_json(state.mode)));
+        std::string payload;
+        JsonWriter writer(payload);
+        write_mode(writer, state.mode);
+        send_reply(client, payload_type, std::move(payload));
         return;
     }
     default:
@@ -582,90 +646,208 @@ void Ipc::handle_command(miracle::Ipc::IpcClient& client, uint32_t payload_lengt
     }
 }
 
-void Ipc::send_reply(miracle::Ipc::IpcClient& client, miracle::IpcCommandType command_type, const std::string& payload)
+void Ipc::send_reply(miracle::Ipc::IpcClient& client, miracle::IpcCommandType command_type, std::string payload)
 {
-    const uint32_t payload_length = payload.size();
-    char data[IPC_HEADER_SIZE];
-
-    memcpy(data, ipc_magic, sizeof(ipc_magic));
-    memcpy(data + sizeof(ipc_magic), &payload_length, sizeof(payload_length));
-    memcpy(data + sizeof(ipc_magic) + sizeof(payload_length), &command_type, sizeof(command_type));
+    send_frame(client, std::make_shared<IpcFrame const>(command_type, std::move(payload)));
+}
 
-    auto new_buffer_size = client.buffer.size();
-    while (client.write_buffer_len + IPC_HEADER_SIZE + payload_length >= new_buffer_size)
-    {
-        if (new_buffer_size == 0)
-            new_buffer_size = 1;
-        new_buffer_size *= 2;
+bool Ipc::send_frame(miracle::Ipc::IpcClient& client, std::shared_ptr<IpcFrame const> const& frame)
+{
+    auto const& ipc_config = config->get_ipc_config();
+    auto pending_bytes = client.write_queue.pending_bytes() + frame->size();
+    if (pending_bytes > ipc_config.max_pending_bytes
+        && ipc_config.slow_client_policy == IpcSlowClientPolicy::drop_events)
+    {
+        client.write_queue.drop_events(pending_bytes - ipc_config.max_pending_bytes);
+        pending_bytes = client.write_queue.pending_bytes() + frame->size();
+        if (pending_bytes > ipc_config.max_pending_bytes && frame->is_event())
+        {
+            mir::log_warning("Client %d is falling behind, dropping event", (int)client.client_fd);
+            return true;
+        }
     }
 
-    if (new_buffer_size > 4e6)
-    { // 4 MB
-        mir::log_error("Client write buffer too big (%zu), disconnecting client", client.buffer.size());
+    if (pending_bytes > ipc_config.max_pending_bytes)
+    {
+        mir::log_error("Client write buffer too big (%zu), disconnecting client", client.write_queue.pending_bytes());
         disconnect(client);
-        return;
+        return false;
     }
 
-    client.buffer.resize(new_buffer_size);
-
-    memcpy(client.buffer.data() + client.write_buffer_len, data, IPC_HEADER_SIZE);
-    client.write_buffer_len += IPC_HEADER_SIZE;
-    memcpy(client.buffer.data() + client.write_buffer_len, payload.c_str(), payload_length);
-    client.write_buffer_len += payload_length;
-    handle_writeable(client);
+    client.write_queue.push(frame);
+    return handle_writeable(client);
 }
 
-void Ipc::handle_writeable(miracle::Ipc::IpcClient& client)
+void Ipc::broadcast(miracle::IpcCommandType event, std::string payload)
 {
-    while (client.write_buffer_len > 0)
+    auto frame = std::make_shared<IpcFrame const>(event, std::move(payload));
+    for (size_t i = 0; i < clients.size();)
     {
-        ssize_t written = write(client.client_fd, client.buffer.data(), client.write_buffer_len);
-        if (written == -1 && errno == EAGAIN)
+        if ((clients[i].subscribed_events & event_mask(event)) == 0)
         {
-            return;
-        }
-        else if (written == -1)
-        {
-            mir::log_error("Unable to send data from queue to IPC client");
-            disconnect(client);
-            return;
+            i++;
+            continue;
         }
 
-        memmove(client.buffer.data(), client.buffer.data() + written, client.write_buffer_len - written);
-        client.write_buffer_len -= written;
+        // A disconnected client is erased, so the next client is now at [i]
+        if (send_frame(clients[i], frame))
+            i++;
     }
-
-    client.write_buffer_len = 0;
 }
 
-namespace
+bool Ipc::handle_writeable(miracle::Ipc::IpcClient& client)
 {
-bool equals(std::string_view const& s, const char* v)
-{
-    // TODO: Perhaps this is a bit naive, as it is basically a "startswith"
-    return strncmp(s.data(), v, strlen(v)) == 0;
+    if (client.write_queue.flush(client.client_fd) == IpcWriteQueue::FlushResult::error)
+    {
+        mir::log_error("Unable to send data from queue to IPC client");
+        disconnect(client);
+        return false;
+    }
+
+    // Whatever did not fit is written as soon as the socket can take more
+    wait_to_write(client, !client.write_queue.empty());
+    return true;
 }
+
+void Ipc::wait_to_write(miracle::Ipc::IpcClient& client, bool wait)
+{
+    if (client.is_waiting_to_write == wait)
+        return;
+
+    epoll_event event {};
+    event.events = EPOLLOUT;
+    event.data.u64 = client.id;
+    if (epoll_ctl(write_epoll, wait ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, client.client_fd, &event) == -1)
+    {
+        mir::log_error("Unable to %s waiting for IPC client %d to be writable", wait ? "start" : "stop", (int)client.client_fd);
+        return;
+    }
+
+    client.is_waiting_to_write = wait;
 }
 
-bool Ipc::parse_i3_command(std::string_view const& command)
+std::shared_ptr<IpcFrame const> const& Ipc::get_tree()
 {
+    auto const& outputs = policy.get_output_list();
+    bool outputs_changed = outputs.size() != tree_cache.outputs.size();
+    for (size_t i = 0; !outputs_changed && i < outputs.size(); i++)
+        outputs_changed = outputs[i].get() != tree_cache.outputs[i];
+
+    auto const generation = TreeGeneration::current();
+    if (tree_cache.frame && !outputs_changed && generation == tree_cache.generation)
+        return tree_cache.frame;
+
+    // Only the outputs and workspaces that have changed since they were last
+    // serialized are serialized again. Everything else is reused as-is. Stale
+    // entries keep their buffers so that rewriting them does not reallocate.
+    std::map<void const*, CachedJson> subtrees;
+    auto const carry_over = [&](void const* key, uint64_t subtree_generation, bool& is_current) -> CachedJson&
+    {
+        auto& entry = subtrees[key];
+        auto it = tree_cache.subtrees.find(key);
+        is_current = it != tree_cache.subtrees.end() && it->second.generation == subtree_generation;
+        if (it != tree_cache.subtrees.end())
+            entry = std::move(it->second);
+
+        if (!is_current)
+        {
+            entry.generation = subtree_generation;
+            entry.json.clear();
+        }
+        return entry;
+    };
+
+    std::string payload;
+    if (tree_cache.frame)
+        payload.reserve(tree_cache.frame->get_payload().size());
+
+    JsonWriter writer(payload);
+    writer.begin_object()
+        .field("id", 0)
+        .field("name", "root");
+    if (!outputs.empty())
     {
-        std::unique_lock lock(pending_commands_mutex);
-        pending_commands = I3ScopedCommandList::parse(command);
+        writer.key("rect");
+        write_rect(writer, outputs[0]->get_area());
     }
+    writer.key("nodes").begin_array();
 
-    queue->enqueue(this, [&]()
+    tree_cache.outputs.clear();
+    std::vector<CachedJson const*> workspaces;
+    for (auto const& output : outputs)
     {
-        size_t num_processed = 0;
+        tree_cache.outputs.push_back(output.get());
+
+        workspaces.clear();
+        auto output_generation = output->get_generation();
+        for (auto const& workspace : output->get_workspaces())
         {
-            std::shared_lock lock(pending_commands_mutex);
-            for (auto const& c : pending_commands)
-                executor.process(c);
-            num_processed = pending_commands.size();
+            // A workspace's json depends on the state of its output as well
+            auto workspace_generation = std::max(output->get_generation(), workspace->get_generation());
+            output_generation = std::max(output_generation, workspace_generation);
+
+            bool is_current;
+            auto& cached = carry_over(workspace.get(), workspace_generation, is_current);
+            if (!is_current)
+            {
+                JsonWriter workspace_writer(cached.json);
+                write_workspace(workspace_writer, output, workspace->get_workspace(), workspace.get());
+            }
+
+            workspaces.push_back(&cached);
         }
 
-        std::unique_lock lock(pending_commands_mutex);
-        pending_commands.erase(pending_commands.begin(), pending_commands.begin() + num_processed);
-    });
-    return true;
+        bool is_current;
+        auto& cached = carry_over(output.get(), output_generation, is_current);
+        if (!is_current)
+        {
+            JsonWriter output_writer(cached.json);
+            output_writer.begin_object();
+            write_output_fields(output_writer, output);
+            output_writer.key("nodes").begin_array();
+            for (auto const& workspace : workspaces)
+                output_writer.raw(workspace->json);
+            output_writer.end_array().end_object();
+        }
+
+        writer.raw(cached.json);
+    }
+
+    writer.end_array().end_object();
+    tree_cache.frame = std::make_shared<IpcFrame const>(IPC_GET_TREE, std::move(payload));
+    tree_cache.subtrees = std::move(subtrees);
+    tree_cache.generation = generation;
+    return tree_cache.frame;
+}
+
+Ipc::IpcClient* Ipc::find_client(int fd, uint64_t id)
+{
+    for (auto& client : clients)
+    {
+        if (client.client_fd == fd && client.id == id)
+            return &client;
+    }
+
+    return nullptr;
+}
+
+void Ipc::send_command_results(int fd, uint64_t id, std::vector<I3CommandResult> const& results)
+{
+    // The client may have gone away while its commands were waiting to run
+    auto client = find_client(fd, id);
+    if (!client)
+        return;
+
+    std::string payload;
+    JsonWriter writer(payload);
+    writer.begin_array();
+    for (auto const& result : results)
+    {
+        writer.begin_object().field("success", result.success);
+        if (!result.success)
+            writer.field("error", result.error);
+        writer.end_object();
+    }
+    writer.end_array();
+    send_reply(*client, IPC_COMMAND, std::move(payload));
 }
@@ -19,14 +19,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIRACLEWM_IPC_H
 
 #include "i3_command.h"
+#include "i3_command_dispatcher.h"
 #include "i3_command_executor.h"
+#include "ipc_frame.h"
 #include "mode_observer.h"
 #include "workspace_manager.h"
 #include "workspace_observer.h"
 #include <mir/fd.h>
 #include <mir/server_action_queue.h>
+#include <map>
 #include <miral/runner.h>
-#include <shared_mutex>
 #include <vector>
 
 struct sockaddr_un;
@@ -37,43 +39,6 @@ namespace miracle
 class Policy;
 class MiracleConfig;
 
-/// This it taken directly from SWAY
-enum IpcCommandType
-{
-    // i3 command types - see i3's I3_REPLY_TYPE constants
-    IPC_COMMAND = 0,
-    IPC_GET_WORKSPACES = 1,
-    IPC_SUBSCRIBE = 2,
-    IPC_GET_OUTPUTS = 3,
-    IPC_GET_TREE = 4,
-    IPC_GET_MARKS = 5,
-    IPC_GET_BAR_CONFIG = 6,
-    IPC_GET_VERSION = 7,
-    IPC_GET_BINDING_MODES = 8,
-    IPC_GET_CONFIG = 9,
-    IPC_SEND_TICK = 10,
-    IPC_SYNC = 11,
-    IPC_GET_BINDING_STATE = 12,
-
-    // sway-specific command types
-    IPC_GET_INPUTS = 100,
-    IPC_GET_SEATS = 101,
-
-    // Events sent from sway to clients. Events have the highest bits set.
-    IPC_EVENT_WORKSPACE = ((1 << 31) | 0),
-    IPC_EVENT_OUTPUT = ((1 << 31) | 1),
-    IPC_EVENT_MODE = ((1 << 31) | 2),
-    IPC_EVENT_WINDOW = ((1 << 31) | 3),
-    IPC_EVENT_BARCONFIG_UPDATE = ((1 << 31) | 4),
-    IPC_EVENT_BINDING = ((1 << 31) | 5),
-    IPC_EVENT_SHUTDOWN = ((1 << 31) | 6),
-    IPC_EVENT_TICK = ((1 << 31) | 7),
-
-    // sway-specific event types
-    IPC_EVENT_BAR_STATE_UPDATE = ((1 << 31) | 20),
-    IPC_EVENT_INPUT = ((1 << 31) | 21),
-};
-
 /// Inter process communication for compositor clients (e.g. waybar).
 /// This class will implement I3's interface: https://i3wm.org/docs/ipc.html
 /// plus some of the sway-specific items.
@@ -97,32 +62,75 @@ private:
     struct IpcClient
     {
         mir::Fd client_fd;
+
+        /// Distinguishes this connection from earlier ones that used the same fd
+        uint64_t id = 0;
         std::unique_ptr<miral::FdHandle> handle;
         uint32_t pending_read_length = 0;
         IpcCommandType pending_type;
-        std::vector<char> buffer;
-        int write_buffer_len = 0;
+        IpcWriteQueue write_queue;
         int subscribed_events = 0;
+
+        /// Whether [write_epoll] is watching for the socket to become writable
+        bool is_waiting_to_write = false;
+    };
+
+    struct CachedJson
+    {
+        uint64_t generation = 0;
+        std::string json;
+    };
+
+    /// The most recent IPC_GET_TREE reply, along with the serialized
+    /// outputs and workspaces that it was assembled from. Subtrees are
+    /// keyed by their [Output] or [Workspace].
+    struct TreeCache
+    {
+        uint64_t generation = 0;
+        std::vector<Output const*> outputs;
+        std::shared_ptr<IpcFrame const> frame;
+        std::map<void const*, CachedJson> subtrees;
     };
 
     WorkspaceManager& workspace_manager;
     Policy& policy;
     mir::Fd ipc_socket;
     std::unique_ptr<miral::FdHandle> socket_handle;
+
+    /// Watches the sockets of clients whose replies and events did not fit in
+    /// their socket buffers. It becomes readable when any of them is writable.
+    mir::Fd write_epoll;
+    std::unique_ptr<miral::FdHandle> write_epoll_handle;
     sockaddr_un* ipc_sockaddr = nullptr;
     std::vector<IpcClient> clients;
-    std::vector<I3ScopedCommandList> pending_commands;
-    mutable std::shared_mutex pending_commands_mutex;
-    std::shared_ptr<mir::ServerActionQueue> queue;
-    I3CommandExecutor& executor;
+    uint64_t next_client_id = 0;
+    I3CommandDispatcher dispatcher;
     std::shared_ptr<MiracleConfig> config;
+    TreeCache tree_cache;
 
     void disconnect(IpcClient& client);
     IpcClient& get_client(int fd);
     void handle_command(IpcClient& client, uint32_t payload_length, IpcCommandType payload_type);
-    void send_reply(IpcClient& client, IpcCommandType command_type, std::string const& payload);
-    void handle_writeable(IpcClient& client);
-    bool parse_i3_command(std::string_view const& command);
+    void send_reply(IpcClient& client, IpcCommandType command_type, std::string payload);
+
+    /// Queue [frame] on [client] and attempt to write it out.
+    /// Returns false if the client was disconnected as a result.
+    bool send_frame(IpcClient& client, std::shared_ptr<IpcFrame const> const& frame);
+
+    /// Send [payload] once to every client that is subscribed to [event].
+    void broadcast(IpcCommandType event, std::string payload);
+    bool handle_writeable(IpcClient& client);
+
+    /// Starts or stops watching [client] for its socket becoming writable.
+    void wait_to_write(IpcClient& client, bool wait);
+
+    /// Returns the client connected on [fd], unless it has since disconnected.
+    IpcClient* find_client(int fd, uint64_t id);
+    void send_command_results(int fd, uint64_t id, std::vector<I3CommandResult> const& results);
+
+    /// Returns the IPC_GET_TREE reply, serializing only the outputs and
+    /// workspaces that have changed since it was last requested.
+    std::shared_ptr<IpcFrame const> const& get_tree();
 };
 }
 
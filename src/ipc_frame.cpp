@@ -0,0 +1,131 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "ipc_frame.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+using namespace miracle;
+
+namespace
+{
+/// Upper bound on the number of iovecs handed to the kernel in one call.
+/// Each frame needs at most two (header and payload).
+constexpr int max_iovecs = 64;
+}
+
+IpcFrame::IpcFrame(IpcCommandType type, std::string payload) :
+    type { type },
+    payload { std::move(payload) }
+{
+    const uint32_t payload_length = this->payload.size();
+    memcpy(header.data(), ipc_magic, sizeof(ipc_magic));
+    memcpy(header.data() + sizeof(ipc_magic), &payload_length, sizeof(payload_length));
+    memcpy(header.data() + sizeof(ipc_magic) + sizeof(payload_length), &type, sizeof(uint32_t));
+}
+
+void IpcWriteQueue::push(std::shared_ptr<IpcFrame const> const& frame)
+{
+    num_pending_bytes += frame->size();
+    frames.push_back(frame);
+}
+
+IpcWriteQueue::FlushResult IpcWriteQueue::flush(int fd)
+{
+    while (!frames.empty())
+    {
+        iovec iov[max_iovecs];
+        int count = 0;
+        size_t offset = front_offset;
+        for (auto it = frames.begin(); it != frames.end() && count + 2 <= max_iovecs; it++)
+        {
+            auto const& header = (*it)->get_header();
+            auto const& payload = (*it)->get_payload();
+            if (offset < header.size())
+            {
+                iov[count++] = { const_cast<char*>(header.data()) + offset, header.size() - offset };
+                offset = 0;
+            }
+            else
+                offset -= header.size();
+
+            if (offset < payload.size())
+                iov[count++] = { const_cast<char*>(payload.data()) + offset, payload.size() - offset };
+            offset = 0;
+        }
+
+        msghdr message {};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (written == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return FlushResult::would_block;
+            return FlushResult::error;
+        }
+
+        consume(written);
+    }
+
+    return FlushResult::done;
+}
+
+size_t IpcWriteQueue::drop_events(size_t count)
+{
+    size_t dropped = 0;
+    auto it = frames.begin();
+    if (it != frames.end() && front_offset > 0)
+        it++;
+
+    while (it != frames.end() && dropped < count)
+    {
+        if ((*it)->is_event())
+        {
+            dropped += (*it)->size();
+            it = frames.erase(it);
+        }
+        else
+            it++;
+    }
+
+    num_pending_bytes -= dropped;
+    return dropped;
+}
+
+void IpcWriteQueue::consume(size_t count)
+{
+    num_pending_bytes -= count;
+    while (count > 0)
+    {
+        size_t remaining_in_front = frames.front()->size() - front_offset;
+        if (count < remaining_in_front)
+        {
+            front_offset += count;
+            return;
+        }
+
+        count -= remaining_in_front;
+        frames.pop_front();
+        front_offset = 0;
+    }
+}
@@ -0,0 +1,147 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_IPC_FRAME_H
+#define MIRACLEWM_IPC_FRAME_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace miracle
+{
+
+/// This it taken directly from SWAY
+enum IpcCommandType
+{
+    // i3 command types - see i3's I3_REPLY_TYPE constants
+    IPC_COMMAND = 0,
+    IPC_GET_WORKSPACES = 1,
+    IPC_SUBSCRIBE = 2,
+    IPC_GET_OUTPUTS = 3,
+    IPC_GET_TREE = 4,
+    IPC_GET_MARKS = 5,
+    IPC_GET_BAR_CONFIG = 6,
+    IPC_GET_VERSION = 7,
+    IPC_GET_BINDING_MODES = 8,
+    IPC_GET_CONFIG = 9,
+    IPC_SEND_TICK = 10,
+    IPC_SYNC = 11,
+    IPC_GET_BINDING_STATE = 12,
+
+    // sway-specific command types
+    IPC_GET_INPUTS = 100,
+    IPC_GET_SEATS = 101,
+
+    // Events sent from sway to clients. Events have the highest bits set.
+    IPC_EVENT_WORKSPACE = ((1 << 31) | 0),
+    IPC_EVENT_OUTPUT = ((1 << 31) | 1),
+    IPC_EVENT_MODE = ((1 << 31) | 2),
+    IPC_EVENT_WINDOW = ((1 << 31) | 3),
+    IPC_EVENT_BARCONFIG_UPDATE = ((1 << 31) | 4),
+    IPC_EVENT_BINDING = ((1 << 31) | 5),
+    IPC_EVENT_SHUTDOWN = ((1 << 31) | 6),
+    IPC_EVENT_TICK = ((1 << 31) | 7),
+
+    // sway-specific event types
+    IPC_EVENT_BAR_STATE_UPDATE = ((1 << 31) | 20),
+    IPC_EVENT_INPUT = ((1 << 31) | 21),
+};
+
+constexpr char ipc_magic[] = { 'i', '3', '-', 'i', 'p', 'c' };
+
+/// A single, fully-formed IPC message (header + payload).
+///
+/// Frames are immutable once built so that the same frame can be queued on
+/// any number of clients by reference. Broadcasting an event therefore costs
+/// one serialization regardless of how many clients are subscribed to it.
+class IpcFrame
+{
+public:
+    static constexpr size_t header_size = sizeof(ipc_magic) + 2 * sizeof(uint32_t);
+
+    IpcFrame(IpcCommandType type, std::string payload);
+
+    [[nodiscard]] IpcCommandType get_type() const { return type; }
+
+    /// Events are unsolicited, so a client that falls behind may miss some of them.
+    /// Replies are always delivered, since the client is blocked waiting on them.
+    [[nodiscard]] bool is_event() const { return (static_cast<uint32_t>(type) & (1u << 31)) != 0; }
+
+    [[nodiscard]] std::array<char, header_size> const& get_header() const { return header; }
+    [[nodiscard]] std::string const& get_payload() const { return payload; }
+
+    /// The total number of bytes that this frame occupies on the wire.
+    [[nodiscard]] size_t size() const { return header_size + payload.size(); }
+
+private:
+    IpcCommandType type;
+    std::array<char, header_size> header;
+    std::string payload;
+};
+
+/// The frames that are waiting to be written to a single IPC client.
+///
+/// Frames are held by reference and written with scatter/gather I/O, so
+/// nothing is copied into a per-client buffer.
+class IpcWriteQueue
+{
+public:
+    enum class FlushResult
+    {
+        /// Every queued frame was written
+        done,
+
+        /// The socket is full and the remaining frames must be written later
+        would_block,
+
+        /// The socket is no longer writeable
+        error
+    };
+
+    void push(std::shared_ptr<IpcFrame const> const& frame);
+
+    /// Write as much of the queue to [fd] as the socket will accept.
+    FlushResult flush(int fd);
+
+    /// Discard the oldest queued events until at least [count] bytes have been freed,
+    /// or until no more events can be dropped. A frame that has been partially written
+    /// is never dropped. Returns the number of bytes freed.
+    size_t drop_events(size_t count);
+
+    [[nodiscard]] bool empty() const { return frames.empty(); }
+
+    /// The number of bytes that are queued but not yet written.
+    [[nodiscard]] size_t pending_bytes() const { return num_pending_bytes; }
+
+private:
+    /// Drop [count] bytes from the front of the queue.
+    void consume(size_t count);
+
+    std::deque<std::shared_ptr<IpcFrame const>> frames;
+
+    /// How far into the front frame we have already written.
+    size_t front_offset = 0;
+    size_t num_pending_bytes = 0;
+};
+
+} // miracle
+
+#endif // MIRACLEWM_IPC_FRAME_H
@@ -0,0 +1,197 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "json_writer.h"
+
+#include <charconv>
+#include <cmath>
+
+using namespace miracle;
+
+namespace
+{
+template <typename T>
+void append_number(std::string& out, T v)
+{
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), v);
+    out.append(buffer, result.ptr);
+}
+}
+
+JsonWriter::JsonWriter(std::string& out) :
+    out { out }
+{
+}
+
+JsonWriter& JsonWriter::begin_object()
+{
+    separate();
+    out += '{';
+    needs_separator = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_object()
+{
+    out += '}';
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_array()
+{
+    separate();
+    out += '[';
+    needs_separator = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_array()
+{
+    out += ']';
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name)
+{
+    separate();
+    write_string(name);
+    out += ':';
+    needs_separator = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view v)
+{
+    separate();
+    write_string(v);
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(char const* v)
+{
+    return value(std::string_view(v));
+}
+
+JsonWriter& JsonWriter::value(bool v)
+{
+    return raw(v ? "true" : "false");
+}
+
+JsonWriter& JsonWriter::value(int v)
+{
+    return value(static_cast<int64_t>(v));
+}
+
+JsonWriter& JsonWriter::value(int64_t v)
+{
+    separate();
+    append_number(out, v);
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t v)
+{
+    separate();
+    append_number(out, v);
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double v)
+{
+    // JSON has no representation for these
+    if (!std::isfinite(v))
+        return null();
+
+    separate();
+    append_number(out, v);
+    needs_separator = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::null()
+{
+    return raw("null");
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json)
+{
+    separate();
+    out += json;
+    needs_separator = true;
+    return *this;
+}
+
+void JsonWriter::separate()
+{
+    if (needs_separator)
+        out += ',';
+}
+
+void JsonWriter::write_string(std::string_view v)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    out += '"';
+    size_t run_start = 0;
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        auto c = static_cast<unsigned char>(v[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        // Copy the unescaped run in one go, then the escape sequence
+        out.append(v.data() + run_start, i - run_start);
+        run_start = i + 1;
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+            break;
+        }
+    }
+    out.append(v.data() + run_start, v.size() - run_start);
+    out += '"';
+}
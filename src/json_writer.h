@@ -0,0 +1,75 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_JSON_WRITER_H
+#define MIRACLEWM_JSON_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace miracle
+{
+
+/// Writes compact JSON directly into a caller-owned string.
+///
+/// Unlike building a document and then serializing it, nothing is allocated
+/// per key or per value: the only allocation is the growth of the output
+/// string, which callers may reserve up front or reuse between documents.
+/// The writer inserts separators itself, but it is up to the caller to
+/// open and close objects and arrays in a valid order.
+class JsonWriter
+{
+public:
+    explicit JsonWriter(std::string& out);
+
+    JsonWriter& begin_object();
+    JsonWriter& end_object();
+    JsonWriter& begin_array();
+    JsonWriter& end_array();
+    JsonWriter& key(std::string_view);
+
+    JsonWriter& value(std::string_view);
+    JsonWriter& value(char const*);
+    JsonWriter& value(bool);
+    JsonWriter& value(int);
+    JsonWriter& value(int64_t);
+    JsonWriter& value(uint64_t);
+    JsonWriter& value(double);
+    JsonWriter& null();
+
+    /// Writes [json] as the next value without escaping it. [json] must
+    /// already be a valid, serialized JSON value.
+    JsonWriter& raw(std::string_view json);
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, T const& v)
+    {
+        return key(name).value(v);
+    }
+
+private:
+    void separate();
+    void write_string(std::string_view);
+
+    std::string& out;
+    bool needs_separator = false;
+};
+
+}
+
+#endif // MIRACLEWM_JSON_WRITER_H
@@ -161,6 +161,8 @@ void LeafContainer::handle_modify(miral::WindowSpecification const& modification
     }
 
     window_controller.modify(window_, mods);
+    if (auto workspace = get_workspace())
+        workspace->mark_dirty();
 }
 
 void LeafContainer::handle_raise()
@@ -212,10 +214,14 @@ void LeafContainer::on_open()
 void LeafContainer::on_focus_gained()
 {
     tree->advise_focus_gained(*this);
+    if (auto workspace = get_workspace())
+        workspace->mark_dirty();
 }
 
 void LeafContainer::on_focus_lost()
 {
+    if (auto workspace = get_workspace())
+        workspace->mark_dirty();
 }
 
 void LeafContainer::on_move_to(geom::Point const&)
@@ -246,6 +252,9 @@ void LeafContainer::commit_changes()
             window_controller.set_rectangle(window_, previous, get_visible_area());
             constrain();
         }
+
+        if (auto workspace = get_workspace())
+            workspace->mark_dirty();
     }
 }
 
@@ -22,8 +22,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "miracle_gl_config.h"
 #include "policy.h"
 #include "renderer.h"
+#include "renderer_statistics.h"
 #include "surface_tracker.h"
 #include "version.h"
+#include "window_snapshots.h"
 
 #include <libnotify/notify.h>
 #include <mir/log.h>
@@ -73,6 +75,8 @@ int main(int argc, char const* argv[])
     ExternalClientLauncher external_client_launcher;
     miracle::AutoRestartingLauncher auto_restarting_launcher(runner, external_client_launcher);
     miracle::SurfaceTracker surface_tracker;
+    miracle::WindowSnapshots window_snapshots;
+    miracle::RendererStatistics renderer_statistics;
     auto config = std::make_shared<miracle::FilesystemConfiguration>(runner);
     for (auto const& env : config->get_env_variables())
     {
@@ -85,7 +89,7 @@ int main(int argc, char const* argv[])
     {
         options = new WindowManagerOptions {
             add_window_manager_policy<miracle::Policy>(
-                "tiling", auto_restarting_launcher, runner, config, surface_tracker, server)
+                "tiling", auto_restarting_launcher, runner, config, surface_tracker, window_snapshots, renderer_statistics, server)
         };
         (*options)(server);
     });
@@ -130,7 +134,7 @@ int main(int argc, char const* argv[])
     }),
             CustomRenderer([&](std::unique_ptr<mir::graphics::gl::OutputSurface> x, std::shared_ptr<mir::graphics::GLRenderingProvider> y)
     {
-        return std::make_unique<miracle::Renderer>(std::move(y), std::move(x), config, surface_tracker);
+        return std::make_unique<miracle::Renderer>(std::move(y), std::move(x), config, surface_tracker, window_snapshots, renderer_statistics);
     }),
             miroil::OpenGLContext(new miracle::GLConfig()) });
 }
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MIR_LOG_COMPONENT "miracle_config"
 
 #include "miracle_config.h"
+#include "easing.h"
 #include "yaml-cpp/node/node.h"
 #include "yaml-cpp/yaml.h"
 #include <cstdlib>
@@ -88,6 +89,16 @@ std::string wrap_command(std::string const& command)
     return command;
 }
 
+IpcSlowClientPolicy from_string_ipc_slow_client_policy(std::string const& value)
+{
+    if (value == "disconnect")
+        return IpcSlowClientPolicy::disconnect;
+    else if (value == "drop_events")
+        return IpcSlowClientPolicy::drop_events;
+    else
+        return IpcSlowClientPolicy::max;
+}
+
 template <typename T>
 bool try_parse_value(YAML::Node const& root, const char* key, T& value)
 {
@@ -180,6 +191,7 @@ void FilesystemConfiguration::_load()
     desired_terminal = "";
     resize_jump = 50;
     border_config = { 0, glm::vec4(0), glm::vec4(0) };
+    ipc_config = {};
 
     // Load the new configuration
     mir::log_info("Configuration is loading...");
@@ -827,6 +839,19 @@ void FilesystemConfiguration::_load()
         }
     }
 
+    if (config["ipc"])
+    {
+        auto const& ipc = config["ipc"];
+        try_parse_value(ipc, "max_pending_bytes", ipc_config.max_pending_bytes);
+        auto policy = try_parse_enum<IpcSlowClientPolicy>(
+            ipc,
+            "slow_client_policy",
+            from_string_ipc_slow_client_policy,
+            IpcSlowClientPolicy::max);
+        if (policy != IpcSlowClientPolicy::max)
+            ipc_config.slow_client_policy = policy;
+    }
+
     read_animation_definitions(config);
 }
 
@@ -887,6 +912,22 @@ void FilesystemConfiguration::read_animation_definitions(YAML::Node const& root)
             if (function == EaseFunction::max)
                 continue;
 
+            if (function == EaseFunction::cubic_bezier)
+            {
+                std::vector<float> points;
+                if (!try_parse_value(node, "bezier", points)
+                    || points.size() != 4
+                    || points[0] < 0 || points[0] > 1
+                    || points[2] < 0 || points[2] > 1)
+                {
+                    mir::log_error("cubic_bezier requires 'bezier: [x1, y1, x2, y2]', with x1 and x2 between 0 and 1");
+                    continue;
+                }
+
+                parsed[(int)event].cubic_bezier = std::make_shared<CubicBezier const>(
+                    points[0], points[1], points[2], points[3]);
+            }
+
             parsed[(int)event].type = type;
             parsed[(int)event].function = function;
             try_parse_value(node, "duration", parsed[(int)event].duration_seconds);
@@ -899,10 +940,46 @@ void FilesystemConfiguration::read_animation_definitions(YAML::Node const& root)
         }
     }
 
+    // Optionally trade the analytic ease functions for interpolated lookup tables
+    int easing_table_size = 0;
+    if (root["easing_lookup_table_size"])
+        try_parse_value(root, "easing_lookup_table_size", easing_table_size);
+
+    if (easing_table_size != 0)
+    {
+        if (easing_table_size < (int)EasingTable::min_size || easing_table_size > (int)EasingTable::max_size)
+        {
+            mir::log_error(
+                "easing_lookup_table_size must be between %zu and %zu, but was %d",
+                EasingTable::min_size,
+                EasingTable::max_size,
+                easing_table_size);
+        }
+        else
+        {
+            for (auto& definition : parsed)
+            {
+                if (!is_polynomial_curve(definition.function))
+                    definition.easing_table = std::make_shared<EasingTable const>(definition, easing_table_size);
+            }
+        }
+    }
+
     animation_defintions = parsed;
 
     if (root["enable_animations"])
         try_parse_value(root, "enable_animations", animations_enabled);
+
+    close_animation_memory_limit_mb = default_close_animation_memory_limit_mb;
+    if (root["close_animation_memory_limit_mb"])
+    {
+        int limit = close_animation_memory_limit_mb;
+        try_parse_value(root, "close_animation_memory_limit_mb", limit);
+        if (limit < 0)
+            mir::log_error("close_animation_memory_limit_mb must not be negative, but was %d", limit);
+        else
+            close_animation_memory_limit_mb = limit;
+    }
 }
 
 void FilesystemConfiguration::_watch(miral::MirRunner& runner)
@@ -1147,6 +1224,11 @@ bool FilesystemConfiguration::are_animations_enabled() const
     return animations_enabled;
 }
 
+size_t FilesystemConfiguration::get_close_animation_memory_limit() const
+{
+    return static_cast<size_t>(close_animation_memory_limit_mb) * 1024 * 1024;
+}
+
 WorkspaceConfig FilesystemConfiguration::get_workspace_config(int key) const
 {
     for (auto const& config : workspace_configs)
@@ -1156,4 +1238,9 @@ WorkspaceConfig FilesystemConfiguration::get_workspace_config(int key) const
     }
 
     return { key, ContainerType::leaf };
-}
\ No newline at end of file
+}
+
+IpcConfig const& FilesystemConfiguration::get_ipc_config() const
+{
+    return ipc_config;
+}
@@ -126,6 +126,24 @@ struct BorderConfig
     glm::vec4 color = glm::vec4(0);
 };
 
+enum class IpcSlowClientPolicy
+{
+    /// Disconnect the client
+    disconnect,
+
+    /// Drop the oldest events that are queued for the client
+    drop_events,
+    max
+};
+
+struct IpcConfig
+{
+    /// The number of bytes that may be queued for a single client before
+    /// [slow_client_policy] is applied.
+    size_t max_pending_bytes = 4 * 1024 * 1024;
+    IpcSlowClientPolicy slow_client_policy = IpcSlowClientPolicy::disconnect;
+};
+
 struct WorkspaceConfig
 {
     int num = -1;
@@ -150,7 +168,12 @@ public:
     [[nodiscard]] virtual BorderConfig const& get_border_config() const = 0;
     [[nodiscard]] virtual std::array<AnimationDefinition, (int)AnimateableEvent::max> const& get_animation_definitions() const = 0;
     [[nodiscard]] virtual bool are_animations_enabled() const = 0;
+
+    /// The most memory, in bytes, that snapshots of closing windows may hold
+    /// on to while their close animations play.
+    [[nodiscard]] virtual size_t get_close_animation_memory_limit() const = 0;
     [[nodiscard]] virtual WorkspaceConfig get_workspace_config(int key) const = 0;
+    [[nodiscard]] virtual IpcConfig const& get_ipc_config() const = 0;
 
     virtual int register_listener(std::function<void(miracle::MiracleConfig&)> const&) = 0;
     /// Register a listener on configuration change. A lower "priority" number signifies that the
@@ -181,7 +204,9 @@ public:
     [[nodiscard]] BorderConfig const& get_border_config() const override;
     [[nodiscard]] std::array<AnimationDefinition, (int)AnimateableEvent::max> const& get_animation_definitions() const override;
     [[nodiscard]] bool are_animations_enabled() const override;
+    [[nodiscard]] size_t get_close_animation_memory_limit() const override;
     [[nodiscard]] WorkspaceConfig get_workspace_config(int key) const override;
+    [[nodiscard]] IpcConfig const& get_ipc_config() const override;
     int register_listener(std::function<void(miracle::MiracleConfig&)> const&) override;
     int register_listener(std::function<void(miracle::MiracleConfig&)> const&, int priority) override;
     void unregister_listener(int handle) override;
@@ -225,8 +250,11 @@ private:
     BorderConfig border_config;
     std::atomic<bool> has_changes = false;
     bool animations_enabled = true;
+    static constexpr int default_close_animation_memory_limit_mb = 64;
+    int close_animation_memory_limit_mb = default_close_animation_memory_limit_mb;
     std::array<AnimationDefinition, (int)AnimateableEvent::max> animation_defintions;
     std::vector<WorkspaceConfig> workspace_configs;
+    IpcConfig ipc_config;
 };
 }
 
@@ -24,5 +24,5 @@ int miracle::GLConfig::depth_buffer_bits() const
 
 int miracle::GLConfig::stencil_buffer_bits() const
 {
-    return 8;
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "opaque_region.h"
+#include "damage_tracker.h"
+#include <cmath>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+bool is_empty(geom::Rectangle const& r)
+{
+    return r.size.width.as_int() <= 0 || r.size.height.as_int() <= 0;
+}
+
+geom::Rectangle from_edges(int left, int top, int right, int bottom)
+{
+    return {
+        geom::Point { left, top },
+        geom::Size { right - left, bottom - top }
+    };
+}
+
+/// The pixels that are wholly inside [rect] once it is moved by [offset]
+geom::Rectangle inner_bounds(geom::Rectangle const& rect, glm::vec2 offset)
+{
+    auto const left = (int)ceilf((float)rect.top_left.x.as_int() + offset.x);
+    auto const top = (int)ceilf((float)rect.top_left.y.as_int() + offset.y);
+    auto const right = (int)floorf((float)(rect.top_left.x.as_int() + rect.size.width.as_int()) + offset.x);
+    auto const bottom = (int)floorf((float)(rect.top_left.y.as_int() + rect.size.height.as_int()) + offset.y);
+    if (right <= left || bottom <= top)
+        return {};
+
+    return {
+        { left, top },
+        { right - left, bottom - top }
+    };
+}
+
+/// Appends the parts of [area] that lie outside of [hole] to [out], as up to four rectangles
+void subtract(geom::Rectangle const& area, geom::Rectangle const& hole, std::vector<geom::Rectangle>& out)
+{
+    auto const overlap = intersection(area, hole);
+    if (is_empty(overlap))
+    {
+        out.push_back(area);
+        return;
+    }
+
+    int const left = area.top_left.x.as_int();
+    int const top = area.top_left.y.as_int();
+    int const right = left + area.size.width.as_int();
+    int const bottom = top + area.size.height.as_int();
+    int const hole_left = overlap.top_left.x.as_int();
+    int const hole_top = overlap.top_left.y.as_int();
+    int const hole_right = hole_left + overlap.size.width.as_int();
+    int const hole_bottom = hole_top + overlap.size.height.as_int();
+
+    if (hole_top > top)
+        out.push_back(from_edges(left, top, right, hole_top));
+    if (hole_bottom < bottom)
+        out.push_back(from_edges(left, hole_bottom, right, bottom));
+    if (hole_left > left)
+        out.push_back(from_edges(left, hole_top, hole_left, hole_bottom));
+    if (hole_right < right)
+        out.push_back(from_edges(hole_right, hole_top, right, hole_bottom));
+}
+}
+
+void OpaqueRegion::clear()
+{
+    rectangles.clear();
+}
+
+void OpaqueRegion::add(geom::Rectangle const& area)
+{
+    if (!is_empty(area))
+        rectangles.push_back(area);
+}
+
+bool OpaqueRegion::covers(geom::Rectangle const& area) const
+{
+    if (is_empty(area))
+        return true;
+
+    uncovered.clear();
+    uncovered.push_back(area);
+    for (auto const& opaque : rectangles)
+    {
+        next_uncovered.clear();
+        for (auto const& part : uncovered)
+            subtract(part, opaque, next_uncovered);
+
+        std::swap(uncovered, next_uncovered);
+        if (uncovered.empty())
+            return true;
+    }
+
+    return false;
+}
+
+std::optional<geom::Rectangle> OpaqueRegion::opaque_area(Layer const& layer)
+{
+    if (layer.shaped || layer.alpha < 1.f || layer.transformation != glm::mat4(1.f))
+        return std::nullopt;
+
+    // Anything but a translation could leave gaps, e.g. when a window is scaled down
+    if (glm::mat3(layer.to_viewport) != glm::mat3(1.f))
+        return std::nullopt;
+
+    auto const offset = glm::vec2(layer.to_viewport[3]);
+    auto area = inner_bounds(layer.screen_position, offset);
+    if (layer.clip_area)
+        area = intersection(area, inner_bounds(layer.clip_area.value(), offset));
+    return area;
+}
+
+bool OpaqueRegion::cull(Layer const& layer)
+{
+    if (covers(layer.bounds))
+        return true;
+
+    if (auto const opaque = opaque_area(layer))
+        add(opaque.value());
+    return false;
+}
@@ -0,0 +1,82 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_OPAQUE_REGION_H
+#define MIRACLEWM_OPAQUE_REGION_H
+
+#include <glm/glm.hpp>
+#include <mir/geometry/rectangle.h>
+#include <optional>
+#include <vector>
+
+namespace miracle
+{
+
+/// The part of an output that is hidden behind opaque content, built up
+/// from the top-most renderable down so that the renderables beneath can
+/// be tested against it before they are drawn.
+class OpaqueRegion
+{
+public:
+    /// A renderable as seen by occlusion culling
+    struct Layer
+    {
+        /// The area that the renderable draws to, in the viewport's coordinates
+        mir::geometry::Rectangle bounds;
+
+        /// Where the renderable is and what it is clipped to, before [to_viewport]
+        mir::geometry::Rectangle screen_position;
+        std::optional<mir::geometry::Rectangle> clip_area;
+
+        bool shaped = false;
+        float alpha = 1.f;
+
+        /// The renderable's own transformation, about its centre
+        glm::mat4 transformation { 1.f };
+
+        /// The output and workspace transforms that move the renderable into the viewport
+        glm::mat4 to_viewport { 1.f };
+    };
+
+    /// The part of [layer] that is drawn fully opaque, or std::nullopt when
+    /// anything beneath it may show through.
+    static std::optional<mir::geometry::Rectangle> opaque_area(Layer const& layer);
+
+    void clear();
+
+    /// Adds an area that is drawn fully opaque. Empty rectangles are ignored.
+    void add(mir::geometry::Rectangle const&);
+
+    /// Whether every pixel of [area] is hidden. An empty area is always hidden.
+    [[nodiscard]] bool covers(mir::geometry::Rectangle const& area) const;
+
+    /// Whether [layer] is hidden by the region. When it is not, its opaque area
+    /// is added, so that culling layers from the top-most down tests each one
+    /// against everything drawn over it.
+    bool cull(Layer const& layer);
+
+private:
+    std::vector<mir::geometry::Rectangle> rectangles;
+
+    /// Reused by covers() for the parts of the area that are still visible
+    std::vector<mir::geometry::Rectangle> mutable uncovered;
+    std::vector<mir::geometry::Rectangle> mutable next_uncovered;
+};
+
+}
+
+#endif // MIRACLEWM_OPAQUE_REGION_H
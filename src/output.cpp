@@ -132,6 +132,7 @@ void Output::advise_new_workspace(int workspace)
     {
         return a->get_workspace() < b->get_workspace();
     });
+    mark_dirty();
 }
 
 void Output::advise_workspace_deleted(int workspace)
@@ -141,6 +142,7 @@ void Output::advise_workspace_deleted(int workspace)
         if (it->get()->get_workspace() == workspace)
         {
             workspaces.erase(it);
+            mark_dirty();
             return;
         }
     }
@@ -170,6 +172,7 @@ bool Output::advise_workspace_active(int key)
         return false;
     }
 
+    mark_dirty();
     if (!from)
     {
         to->show();
@@ -236,8 +239,13 @@ bool Output::advise_workspace_active(int key)
         if (asr.transform)
             set_transform(asr.transform.value());
 
+        // Every window on the output picks the new transform up from a single
+        // uniform, so touching one window is enough to get the frame drawn
         for (auto const& workspace : workspaces)
-            workspace->trigger_rerender();
+        {
+            if (workspace->trigger_output_rerender())
+                break;
+        }
     });
 
     active_workspace = key;
@@ -290,6 +298,7 @@ void Output::update_area(geom::Rectangle const& new_area)
     area = new_area;
     for (auto& workspace : workspaces)
         workspace->set_area(area);
+    mark_dirty();
 }
 
 std::vector<miral::Window> Output::collect_all_windows() const
@@ -348,6 +357,17 @@ geom::Rectangle Output::get_workspace_rectangle(int workspace) const
     };
 }
 
+void Output::set_is_active(bool new_is_active)
+{
+    is_active_ = new_is_active;
+    mark_dirty();
+}
+
+void Output::mark_dirty()
+{
+    generation = TreeGeneration::next();
+}
+
 glm::mat4 Output::get_transform() const
 {
     return final_transform;
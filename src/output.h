@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "direction.h"
 #include "miral/window.h"
 #include "tiling_window_tree.h"
+#include "tree_generation.h"
 
 #include "workspace.h"
 #include <memory>
@@ -64,6 +65,7 @@ public:
     void advise_application_zone_delete(miral::Zone const& application_zone);
     bool point_is_in_output(int x, int y);
     void update_area(geom::Rectangle const& area);
+    void set_output(miral::Output const& updated) { output = updated; }
 
     void request_toggle_active_float();
 
@@ -76,10 +78,13 @@ public:
     /// Takes an existing [Container] object and places it in an appropriate position
     /// on the active [Workspace].
     void graft(std::shared_ptr<Container> const& container);
-    void set_is_active(bool new_is_active) { is_active_ = new_is_active; }
+    void set_is_active(bool new_is_active);
     void set_transform(glm::mat4 const& in);
     void set_position(glm::vec2 const&);
 
+    /// Signals that state reported over IPC has changed for this output.
+    void mark_dirty();
+
     // Getters
 
     [[nodiscard]] std::vector<miral::Window> collect_all_windows() const;
@@ -94,6 +99,7 @@ public:
     /// Gets the relative position of the current rectangle (e.g. the active
     /// rectangle with be at position (0, 0))
     [[nodiscard]] geom::Rectangle get_workspace_rectangle(int workspace) const;
+    [[nodiscard]] uint64_t get_generation() const { return generation; }
 
 private:
     miral::Output output;
@@ -111,6 +117,7 @@ private:
     bool is_active_ = false;
     AnimationHandle handle;
     bool has_clicked_floating_window = false;
+    uint64_t generation = TreeGeneration::next();
 
     /// The position of the output for scrolling across workspaces
     glm::vec2 position_offset = glm::vec2(0.f);
@@ -360,8 +360,15 @@ void ParentContainer::set_logical_area(const geom::Rectangle& target_rect)
 
 void ParentContainer::commit_changes()
 {
-    for (auto& node : sub_nodes)
-        node->commit_changes();
+    // Siblings are laid out together, so they are animated as one group
+    {
+        WindowControllerBatch batch { node_interface };
+        for (auto& node : sub_nodes)
+            node->commit_changes();
+    }
+
+    if (auto workspace = get_workspace())
+        workspace->mark_dirty();
 }
 
 std::shared_ptr<Container> ParentContainer::at(size_t i) const
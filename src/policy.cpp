@@ -26,8 +26,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <iostream>
 #include <mir/geometry/rectangle.h>
+#include <mir/input/scene.h>
 #include <mir/log.h>
+#include <mir/scene/surface.h>
 #include <mir/server.h>
+#include <mir/shell/surface_stack.h>
 #include <mir_toolkit/events/enums.h>
 #include <miral/application_info.h>
 #include <miral/runner.h>
@@ -48,6 +51,8 @@ Policy::Policy(
     miral::MirRunner& runner,
     std::shared_ptr<MiracleConfig> const& config,
     SurfaceTracker& surface_tracker,
+    WindowSnapshots& window_snapshots,
+    RendererStatistics const& renderer_statistics,
     mir::Server const& server) :
     window_manager_tools { tools },
     floating_window_manager(std::make_shared<miral::MinimalWindowManager>(tools, config->get_input_event_modifier())),
@@ -63,8 +68,14 @@ Policy::Policy(
     window_controller(tools, animator, state),
     i3_command_executor(*this, workspace_manager, tools, external_client_launcher, window_controller),
     surface_tracker { surface_tracker },
+    window_snapshots { window_snapshots },
+    renderer_statistics { renderer_statistics },
+    scene { std::dynamic_pointer_cast<mir::input::Scene>(server.the_surface_stack()) },
     ipc { std::make_shared<Ipc>(runner, workspace_manager, *this, server.the_main_loop(), i3_command_executor, config) }
 {
+    if (!scene)
+        mir::log_warning("Policy: the surface stack is not a scene, close animations will not be redrawn");
+
     animator.start();
     workspace_observer_registrar.register_interest(ipc);
     mode_observer_registrar.register_interest(ipc);
@@ -248,7 +259,7 @@ void Policy::advise_new_window(miral::WindowInfo const& window_info)
         if (!output_list.empty())
         {
             // Our output is gone! Let's try to add it to a different output
-            output_list.front()->add_immediately(window);
+            add_immediately(output_list.front(), window);
         }
         else
         {
@@ -263,6 +274,7 @@ void Policy::advise_new_window(miral::WindowInfo const& window_info)
     }
 
     auto container = shared_output->create_container(window_info, pending_type);
+    index_window(window_info.window());
 
     container->animation_handle(animator.register_animateable());
     container->on_open();
@@ -331,6 +343,8 @@ void Policy::advise_delete_window(const miral::WindowInfo& window_info)
         return;
     }
 
+    window_index.remove(container->get_id());
+    animate_close(window_info.window(), container);
     if (container->get_output())
         container->get_output()->delete_container(container);
 
@@ -340,6 +354,39 @@ void Policy::advise_delete_window(const miral::WindowInfo& window_info)
         state.active = nullptr;
 }
 
+void Policy::animate_close(miral::Window const& window, std::shared_ptr<Container> const& container)
+{
+    if (!config->are_animations_enabled()
+        || config->get_animation_definitions()[(int)AnimateableEvent::window_close].type == AnimationType::disabled)
+        return;
+
+    auto surface = window.operator std::shared_ptr<mir::scene::Surface>();
+    if (!surface)
+        return;
+
+    auto handle = container->animation_handle();
+    bool const captured = window_snapshots.add(
+        handle,
+        surface->generate_renderables(&window_snapshots),
+        container->get_output_transform() * container->get_workspace_transform(),
+        config->get_close_animation_memory_limit());
+    if (!captured)
+    {
+        mir::log_debug("animate_close: window is closing without an animation, as it could not be snapshotted");
+        return;
+    }
+
+    animator.window_close(handle, [this](AnimationStepResult const& result)
+    {
+        window_snapshots.on_animation(result);
+
+        // The snapshot is not a surface, so nothing in Mir's scene changes on its own. This
+        // holds until the final step has erased it, even when no other window is left to draw.
+        if (scene)
+            scene->emit_scene_changed();
+    });
+}
+
 void Policy::advise_move_to(miral::WindowInfo const& window_info, geom::Point top_left)
 {
     auto container = window_controller.get_container(window_info.window());
@@ -368,10 +415,12 @@ void Policy::advise_output_create(miral::Output const& output)
         mir::log_info("Policy::advise_output_create: orphaned windows are being added to the new output, num=%zu", orphaned_window_list.size());
         for (auto& window : orphaned_window_list)
         {
-            active_output->add_immediately(window);
+            add_immediately(active_output, window);
         }
         orphaned_window_list.clear();
     }
+
+    update_refresh_rate();
 }
 
 void Policy::advise_output_update(miral::Output const& updated, miral::Output const& original)
@@ -380,10 +429,13 @@ void Policy::advise_output_update(miral::Output const& updated, miral::Output co
     {
         if (output->get_output().is_same_output(original))
         {
+            output->set_output(updated);
             output->update_area(updated.extents());
             break;
         }
     }
+
+    update_refresh_rate();
 }
 
 void Policy::advise_output_delete(miral::Output const& output)
@@ -425,7 +477,7 @@ void Policy::advise_output_delete(miral::Output const& output)
                 active_output = output_list.front();
                 for (auto& window : other_output->collect_all_windows())
                 {
-                    active_output->add_immediately(window);
+                    add_immediately(active_output, window);
                 }
 
                 remove_workspaces();
@@ -433,6 +485,19 @@ void Policy::advise_output_delete(miral::Output const& output)
             break;
         }
     }
+
+    update_refresh_rate();
+}
+
+void Policy::update_refresh_rate()
+{
+    // Animations are stepped at the rate of the fastest output. Slower outputs
+    // simply show whichever frame is current when they next refresh.
+    double refresh_rate = 0;
+    for (auto const& output : output_list)
+        refresh_rate = std::max(refresh_rate, output->get_output().refresh_rate());
+
+    animator.set_refresh_rate(refresh_rate > 0 ? refresh_rate : Animator::default_refresh_rate);
 }
 
 void Policy::handle_modify_window(
@@ -447,6 +512,9 @@ void Policy::handle_modify_window(
     }
 
     container->handle_modify(modifications);
+
+    // The title or app_id may have changed
+    window_index.update(container->get_id(), window_info.name(), window_info.application_id());
 }
 
 void Policy::handle_raise_window(miral::WindowInfo& window_info)
@@ -733,10 +801,37 @@ bool Policy::toggle_floating()
     if (!active_output)
         return false;
 
+    // Toggling replaces the window's container with a new one
+    auto previous = state.active;
     active_output->request_toggle_active_float();
+    if (previous)
+    {
+        window_index.remove(previous->get_id());
+        if (auto window = previous->window())
+            index_window(*window);
+    }
     return true;
 }
 
+void Policy::add_immediately(std::shared_ptr<Output> const& output, miral::Window& window)
+{
+    if (auto previous = window_controller.get_container(window))
+        window_index.remove(previous->get_id());
+
+    output->add_immediately(window);
+    index_window(window);
+}
+
+void Policy::index_window(miral::Window const& window)
+{
+    auto container = window_controller.get_container(window);
+    if (!container)
+        return;
+
+    auto& info = window_controller.info_for(window);
+    window_index.add(container->get_id(), container, info.name(), info.application_id());
+}
+
 bool Policy::toggle_pinned_to_workspace()
 {
     if (state.mode == WindowManagerMode::resizing)
@@ -26,8 +26,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "miracle_config.h"
 #include "mode_observer.h"
 #include "output.h"
+#include "renderer_statistics.h"
 #include "surface_tracker.h"
+#include "window_index.h"
 #include "window_manager_tools_window_controller.h"
+#include "window_snapshots.h"
 
 #include "workspace_manager.h"
 
@@ -44,6 +47,11 @@ namespace miral
 class MirRunner;
 }
 
+namespace mir::input
+{
+class Scene;
+}
+
 namespace miracle
 {
 
@@ -58,6 +66,8 @@ public:
         miral::MirRunner&,
         std::shared_ptr<MiracleConfig> const&,
         SurfaceTracker&,
+        WindowSnapshots&,
+        RendererStatistics const&,
         mir::Server const&);
     ~Policy() override;
 
@@ -122,8 +132,24 @@ public:
     std::vector<std::shared_ptr<Output>> const& get_output_list() { return output_list; }
     [[nodiscard]] geom::Point const& get_cursor_position() const { return state.cursor_position; }
     [[nodiscard]] CompositorState const& get_state() const { return state; }
+    [[nodiscard]] WindowIndex const& get_window_index() const { return window_index; }
+
+    /// What the renderers of every output have drawn so far.
+    [[nodiscard]] RendererStats get_renderer_stats() const { return renderer_statistics.get(); }
 
 private:
+    /// Adds [window] to [output] with a new container, keeping the [WindowIndex] in step.
+    void add_immediately(std::shared_ptr<Output> const& output, miral::Window& window);
+
+    /// Indexes [window] under the container that is currently attached to it.
+    void index_window(miral::Window const& window);
+
+    void update_refresh_rate();
+
+    /// Snapshots [window] and plays its close animation on the snapshot, so
+    /// that the window's container can be removed straight away.
+    void animate_close(miral::Window const& window, std::shared_ptr<Container> const& container);
+
     std::shared_ptr<Output> active_output;
     std::vector<std::shared_ptr<Output>> output_list;
     std::weak_ptr<Output> pending_output;
@@ -138,10 +164,16 @@ private:
     ModeObserverRegistrar mode_observer_registrar;
     WorkspaceManager workspace_manager;
     std::shared_ptr<Ipc> ipc;
+    WindowIndex window_index;
     Animator animator;
     WindowManagerToolsWindowController window_controller;
     I3CommandExecutor i3_command_executor;
     SurfaceTracker& surface_tracker;
+    WindowSnapshots& window_snapshots;
+    RendererStatistics const& renderer_statistics;
+
+    /// Used to have Mir composite while the snapshots change, as it knows nothing of them
+    std::shared_ptr<mir::input::Scene> scene;
     CompositorState state;
 };
 }
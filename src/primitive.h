@@ -34,7 +34,8 @@ namespace gl
     {
         enum
         {
-            max_vertices = 4
+            // Enough for a quad, or for a frame as a single triangle strip
+            max_vertices = 10
         };
 
         Primitive() :
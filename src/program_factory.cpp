@@ -31,6 +31,7 @@ attribute vec2 texcoord;
 
 uniform mat4 screen_to_gl_coords;
 uniform mat4 display_transform;
+uniform mat4 output_transform;
 uniform mat4 workspace_transform;
 uniform mat4 transform;
 uniform vec2 centre;
@@ -40,10 +41,37 @@ varying vec2 v_texcoord;
 void main() {
    vec4 mid = vec4(centre, 0.0, 0.0);
    vec4 transformed = (transform * (vec4(position, 1.0) - mid)) + mid;
-   gl_Position = display_transform * screen_to_gl_coords * workspace_transform * transformed;
+   gl_Position = display_transform * screen_to_gl_coords * output_transform * workspace_transform * transformed;
    v_texcoord = texcoord;
 }
 )";
+
+const GLchar* const border_vertex_shader_src = R"(
+attribute vec4 position;
+attribute vec4 color;
+
+uniform mat4 screen_to_gl_coords;
+uniform mat4 display_transform;
+
+varying vec4 v_color;
+
+void main() {
+   gl_Position = display_transform * screen_to_gl_coords * position;
+   v_color = color;
+}
+)";
+
+const GLchar* const border_fragment_shader_src = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+varying vec4 v_color;
+
+void main() {
+    gl_FragColor = v_color;
+}
+)";
 }
 
 miracle::ProgramData::ProgramData(GLuint program_id)
@@ -71,6 +99,10 @@ miracle::ProgramData::ProgramData(GLuint program_id)
     if (display_transform_uniform < 0)
         mir::log_warning("Program is missing display_transform_uniform");
 
+    output_transform_uniform = glGetUniformLocation(id, "output_transform");
+    if (output_transform_uniform < 0)
+        mir::log_warning("Program is missing output_transform_uniform");
+
     workspace_transform_uniform = glGetUniformLocation(id, "workspace_transform");
     if (workspace_transform_uniform < 0)
         mir::log_warning("Program is missing workspace_transform_uniform");
@@ -92,6 +124,25 @@ miracle::ProgramData::ProgramData(GLuint program_id)
         mir::log_warning("Program is missing outline_color_uniform");
 }
 
+miracle::BorderProgramData::BorderProgramData(GLuint program_id)
+{
+    id = program_id;
+    position_attr = glGetAttribLocation(id, "position");
+    if (position_attr < 0)
+        mir::log_warning("Border program is missing position_attr");
+    color_attr = glGetAttribLocation(id, "color");
+    if (color_attr < 0)
+        mir::log_warning("Border program is missing color_attr");
+
+    display_transform_uniform = glGetUniformLocation(id, "display_transform");
+    if (display_transform_uniform < 0)
+        mir::log_warning("Border program is missing display_transform_uniform");
+
+    screen_to_gl_coords_uniform = glGetUniformLocation(id, "screen_to_gl_coords");
+    if (screen_to_gl_coords_uniform < 0)
+        mir::log_warning("Border program is missing screen_to_gl_coords_uniform");
+}
+
 miracle::Program::Program(
     ProgramHandle&& opaque_shader, ProgramHandle&& alpha_shader, ProgramHandle&& outline_shader) :
     opaque_handle(std::move(opaque_shader)),
@@ -104,7 +155,11 @@ miracle::Program::Program(
 }
 
 miracle::ProgramFactory::ProgramFactory() :
-    vertex_shader { compile_shader(GL_VERTEX_SHADER, vertex_shader_src) }
+    vertex_shader { compile_shader(GL_VERTEX_SHADER, vertex_shader_src) },
+    border_handle { link_shader(
+        ShaderHandle { compile_shader(GL_VERTEX_SHADER, border_vertex_shader_src) },
+        ShaderHandle { compile_shader(GL_FRAGMENT_SHADER, border_fragment_shader_src) }) },
+    border { border_handle }
 {
 }
 
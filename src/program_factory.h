@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <GLES2/gl2.h>
 #include <array>
+#include <glm/glm.hpp>
 #include <mir/graphics/program.h>
 #include <mir/graphics/program_factory.h>
 #include <mutex>
@@ -77,6 +78,7 @@ struct ProgramData
     GLint texcoord_attr = -1;
     GLint centre_uniform = -1;
     GLint display_transform_uniform = -1;
+    GLint output_transform_uniform = -1;
     GLint workspace_transform_uniform = -1;
     GLint transform_uniform = -1;
     GLint screen_to_gl_coords_uniform = -1;
@@ -84,9 +86,26 @@ struct ProgramData
     GLint outline_color_uniform = -1;
     mutable long long last_used_frameno = 0;
 
+    /// The output transform last uploaded to this program. Every window on an
+    /// output shares it, so it is normally uploaded once per frame.
+    mutable glm::mat4 last_output_transform = glm::mat4(1.f);
+
     ProgramData(GLuint program_id);
 };
 
+/// Draws the window borders of a whole output at once from a [BorderBatch],
+/// whose vertices are already in the viewport's logical coordinates.
+struct BorderProgramData
+{
+    GLuint id = 0;
+    GLint position_attr = -1;
+    GLint color_attr = -1;
+    GLint display_transform_uniform = -1;
+    GLint screen_to_gl_coords_uniform = -1;
+
+    BorderProgramData(GLuint program_id);
+};
+
 struct Program : public mir::graphics::gl::Program
 {
 public:
@@ -104,6 +123,8 @@ public:
         char const* extension_fragment,
         char const* fragment_fragment) override;
 
+    [[nodiscard]] BorderProgramData const& get_border_program() const { return border; }
+
 private:
     static GLuint compile_shader(GLenum type, GLchar const* src);
     static ProgramHandle link_shader(
@@ -111,6 +132,8 @@ private:
         ShaderHandle const& fragment_shader);
 
     ShaderHandle const vertex_shader;
+    ProgramHandle const border_handle;
+    BorderProgramData const border;
     std::vector<std::pair<void const*, std::unique_ptr<Program>>> programs;
     // GL requires us to synchronise multi-threaded access to the shader APIs.
     std::mutex compilation_mutex;
@@ -0,0 +1,106 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#define MIR_LOG_COMPONENT "miracle::regex_cache"
+#include "regex_cache.h"
+#include <mir/log.h>
+
+using namespace miracle;
+
+namespace
+{
+/// Enough for every distinct criteria in a typical configuration and set of scripts
+const size_t default_capacity = 64;
+
+std::optional<std::string> parse_exact_match(std::string const& pattern)
+{
+    if (pattern.size() < 2 || pattern.front() != '^' || pattern.back() != '$')
+        return std::nullopt;
+
+    auto literal = pattern.substr(1, pattern.size() - 2);
+    if (literal.find_first_of("\\.^$|?*+()[]{}") != std::string::npos)
+        return std::nullopt;
+
+    return literal;
+}
+}
+
+CompiledRegex::CompiledRegex(std::string const& pattern) :
+    regex(pattern, "S") // "S" requests JIT compilation
+{
+    if (!regex)
+    {
+        mir::log_error("Unable to compile regex '%s': %s", pattern.c_str(), regex.getErrorMessage().c_str());
+        return;
+    }
+
+    exact_match = parse_exact_match(pattern);
+}
+
+bool CompiledRegex::is_valid() const
+{
+    return !!regex;
+}
+
+bool CompiledRegex::matches(std::string const& subject) const
+{
+    if (!regex)
+        return false;
+
+    return regex.match(subject) > 0;
+}
+
+RegexCache::RegexCache(size_t capacity) :
+    capacity { capacity }
+{
+}
+
+std::shared_ptr<CompiledRegex const> RegexCache::get(std::string const& pattern)
+{
+    std::lock_guard lock(mutex);
+    auto it = index.find(pattern);
+    if (it != index.end())
+    {
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    auto compiled = std::make_shared<CompiledRegex const>(pattern);
+    entries.emplace_front(pattern, compiled);
+    index[pattern] = entries.begin();
+
+    if (entries.size() > capacity)
+    {
+        // Anyone still holding the evicted regex keeps it alive
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+
+    return compiled;
+}
+
+size_t RegexCache::size() const
+{
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+RegexCache& RegexCache::get_instance()
+{
+    static RegexCache instance(default_capacity);
+    return instance;
+}
@@ -0,0 +1,89 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_REGEX_CACHE_H
+#define MIRACLEWM_REGEX_CACHE_H
+
+#include "jpcre2.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace miracle
+{
+
+/// A PCRE2 regex that is compiled once, with JIT enabled, and may then be
+/// matched against any number of subjects.
+class CompiledRegex
+{
+public:
+    explicit CompiledRegex(std::string const& pattern);
+
+    /// Returns false if the pattern failed to compile.
+    [[nodiscard]] bool is_valid() const;
+    [[nodiscard]] bool matches(std::string const& subject) const;
+
+    /// If the pattern can only ever match one exact string, such as
+    /// "^Firefox$", this is that string. Such patterns may be resolved
+    /// with a lookup instead of a match against every candidate.
+    [[nodiscard]] std::optional<std::string> const& get_exact_match() const { return exact_match; }
+
+private:
+    std::optional<std::string> exact_match;
+
+    // jpcre2 does not mark matching as const, although it leaves the compiled
+    // pattern untouched
+    mutable jpcre2::select<char>::Regex regex;
+};
+
+/// A least-recently-used cache of compiled regexes, keyed by pattern.
+///
+/// Criteria such as [title="..."] tend to be sent with the same pattern
+/// over and over by key bindings and scripts, so compiling each pattern
+/// once and sharing the result between commands saves recompiling it
+/// every time a command arrives. Safe to use from any thread.
+class RegexCache
+{
+public:
+    explicit RegexCache(size_t capacity);
+
+    /// Returns the compiled form of [pattern], compiling it if it is not
+    /// already cached. Patterns that fail to compile are cached too, so
+    /// that they are not retried each time.
+    std::shared_ptr<CompiledRegex const> get(std::string const& pattern);
+    [[nodiscard]] size_t size() const;
+
+    /// The cache shared by all i3 commands.
+    static RegexCache& get_instance();
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<CompiledRegex const>>;
+
+    size_t capacity;
+    mutable std::mutex mutex;
+
+    /// Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+};
+
+}
+
+#endif // MIRACLEWM_REGEX_CACHE_H
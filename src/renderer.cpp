@@ -22,14 +22,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "miracle_config.h"
 #include "program_factory.h"
 #include "tessellation_helpers.h"
+#include "vertex_buffer.h"
 
 #include "container.h"
 #include "window_tools_accessor.h"
 #include "workspace.h"
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <mir/graphics/buffer.h>
@@ -131,13 +136,53 @@ private:
     int outline_width_px;
     float _alpha;
 };
+
+/// The smallest rectangle containing [rect] once it is transformed by [matrix]
+geom::Rectangle transformed_bounds(geom::Rectangle const& rect, glm::mat4 const& matrix)
+{
+    float const left = (float)rect.top_left.x.as_int();
+    float const top = (float)rect.top_left.y.as_int();
+    float const right = left + (float)rect.size.width.as_int();
+    float const bottom = top + (float)rect.size.height.as_int();
+
+    glm::vec2 min { INFINITY, INFINITY };
+    glm::vec2 max { -INFINITY, -INFINITY };
+    for (auto const& corner : { glm::vec2 { left, top }, glm::vec2 { right, top }, glm::vec2 { left, bottom }, glm::vec2 { right, bottom } })
+    {
+        auto const point = glm::vec2(matrix * glm::vec4(corner, 0, 1));
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    auto const x = (int)floorf(min.x);
+    auto const y = (int)floorf(min.y);
+    return {
+        { x, y },
+        { (int)ceilf(max.x) - x, (int)ceilf(max.y) - y }
+    };
+}
+
+geom::Rectangle grow(geom::Rectangle const& rect, int by)
+{
+    return {
+        { rect.top_left.x.as_int() - by, rect.top_left.y.as_int() - by },
+        { rect.size.width.as_int() + 2 * by, rect.size.height.as_int() + 2 * by }
+    };
+}
+
+uint64_t area_of(geom::Rectangle const& rect)
+{
+    return (uint64_t)rect.size.width.as_int() * (uint64_t)rect.size.height.as_int();
+}
 }
 
 Renderer::Renderer(
     std::shared_ptr<mir::graphics::GLRenderingProvider> gl_interface,
     std::unique_ptr<mir::graphics::gl::OutputSurface> output,
     std::shared_ptr<MiracleConfig> const& config,
-    SurfaceTracker& surface_tracker) :
+    SurfaceTracker& surface_tracker,
+    WindowSnapshots const& window_snapshots,
+    RendererStatistics& statistics) :
     output_surface { make_output_current(std::move(output)) },
     clear_color { 0.0f, 0.0f, 0.0f, 1.0f },
     program_factory { std::make_unique<ProgramFactory>() },
@@ -145,7 +190,9 @@ Renderer::Renderer(
     screen_to_gl_coords(1),
     gl_interface { std::move(gl_interface) },
     config { config },
-    surface_tracker { surface_tracker }
+    surface_tracker { surface_tracker },
+    window_snapshots { window_snapshots },
+    statistics { statistics }
 {
     // http://directx.com/2014/06/egl-understanding-eglchooseconfig-then-ignoring-it/
     eglBindAPI(EGL_OPENGL_ES_API);
@@ -167,6 +214,10 @@ Renderer::Renderer(
             auto val = eglQueryString(disp, s.id);
             mir::log_info(std::string(s.label) + ": " + (val ? val : ""));
         }
+
+        // Without the buffer age we cannot know what a buffer holds, so every frame is redrawn in full
+        auto const extensions = eglQueryString(disp, EGL_EXTENSIONS);
+        has_buffer_age = extensions && strstr(extensions, "EGL_EXT_buffer_age");
     }
 
     struct
@@ -201,10 +252,23 @@ Renderer::Renderer(
     mir::log_info("GL framebuffer bits: RGBA=%d%d%d%d, depth=%d, stencil=%d",
         rbits, gbits, bbits, abits, dbits, sbits);
 
-    has_stencil_support = dbits > 0;
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+Renderer::~Renderer()
+{
+    auto const stats = get_stats();
+    mir::log_debug("Renderer: drew %llu frames, redrawing %llu pixels and culling %llu draws",
+        (unsigned long long)stats.frames, (unsigned long long)stats.pixels_redrawn,
+        (unsigned long long)stats.culled_draws);
+    statistics.remove(this);
+}
+
+RendererStats Renderer::get_stats() const
+{
+    return statistics.get(this);
+}
+
 void Renderer::tessellate(
     std::vector<mgl::Primitive>& primitives,
     mg::Renderable const& renderable)
@@ -227,7 +291,8 @@ Renderer::DrawData Renderer::get_draw_data(mir::graphics::Renderable const& rend
             auto userdata = static_pointer_cast<Container>(info.userdata());
             data.needs_outline = (userdata->get_type() == ContainerType::leaf || userdata->get_type() == ContainerType::floating)
                 && !info.parent();
-            data.workspace_transform = userdata->get_output_transform() * userdata->get_workspace_transform();
+            data.workspace_transform = userdata->get_workspace_transform();
+            data.output_transform = userdata->get_output_transform();
             data.is_focused = userdata->is_focused();
         }
     }
@@ -240,31 +305,97 @@ auto Renderer::render(mg::RenderableList const& renderables) const -> std::uniqu
     output_surface->make_current();
     output_surface->bind();
 
-    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
-    glClearStencil(0);
-    glStencilMask(0xFF);
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    draw_list.clear();
+    for (auto const& r : renderables)
+        draw_list.push_back({ r, get_draw_data(*r) });
+
+    // Windows that have closed linger over the scene while their close animations play
+    window_snapshots.for_each([this](std::shared_ptr<mg::Renderable const> const& renderable, glm::mat4 const& workspace_transform)
+    {
+        draw_list.push_back({ renderable, DrawData { true, false, workspace_transform } });
+    });
+
+    auto const redraw_area = find_redraw_area();
+    if (redraw_area)
+    {
+        redraw_scissor = to_framebuffer(redraw_area.value());
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(
+            redraw_scissor->top_left.x.as_int(),
+            redraw_scissor->top_left.y.as_int(),
+            redraw_scissor->size.width.as_int(),
+            redraw_scissor->size.height.as_int());
+    }
 
     ++frameno;
-    for (auto const& r : renderables)
+
+    // When nothing changed the buffer already holds this frame
+    bool const needs_redraw = !redraw_area || area_of(redraw_area.value()) > 0;
+
+    // Counted in the framebuffer, where a scaled output has more pixels than its viewport
+    uint64_t frame_pixels = 0;
+    uint64_t frame_culled = 0;
+    if (needs_redraw)
+    {
+        frame_pixels = redraw_scissor ? area_of(redraw_scissor.value()) : area_of(gl_viewport);
+        frame_culled = cull_occluded(redraw_area);
+    }
+    statistics.add_frame(this, frame_pixels, frame_culled);
+
+    if (needs_redraw)
     {
-        auto data = draw(*r, get_draw_data(*r));
-        if (data.enabled && data.outline_context.enabled)
+        // The vertices of everything drawn this frame are uploaded together, before any draw
+        frame_vertices.clear();
+        frame_primitives.clear();
+        for (auto& item : draw_list)
         {
-            if (has_stencil_support)
-            {
-                OutlineRenderable outline(*r, data.outline_context.size, data.outline_context.color.a);
-                draw(outline, data);
-                glClear(GL_STENCIL_BUFFER_BIT);
-            }
-            else
+            item.drawn = !item.occluded
+                && (!redraw_area || area_of(intersection(item.bounds, redraw_area.value())) > 0);
+            if (item.drawn)
+                tessellate_item(item);
+        }
+        vertex_buffer.upload(frame_vertices);
+
+        glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        for (auto const& item : draw_list)
+        {
+            if (!item.drawn)
+                continue;
+
+            // Borders are drawn after the windows, unless this window would cover one of them
+            if (!border_batch.empty() && border_batch.overlaps(item.content_bounds))
+                draw_borders();
+
+            auto data = draw(*item.renderable, item.data, item.primitives);
+            if (data.enabled && data.outline_context.enabled)
             {
-                mir::log_warning("Renderer::render: outlines are not supported for the provided surface");
+                if (item.renderable->clip_area())
+                {
+                    // Clipping needs a scissor of its own, so these are drawn one at a time.
+                    // Batched borders from beneath must be drawn first, or they would end up on top.
+                    if (!border_batch.empty() && border_batch.overlaps(item.bounds))
+                        draw_borders();
+
+                    OutlineRenderable outline(*item.renderable, data.outline_context.size, data.outline_context.color.a);
+                    draw(outline, data, item.outline_primitives);
+                }
+                else
+                {
+                    add_border(*item.renderable, data);
+                }
             }
         }
+
+        draw_borders();
     }
 
+    redraw_scissor.reset();
+    glDisable(GL_SCISSOR_TEST);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
     auto output = output_surface->commit();
 
     // Report any GL errors after commit, to catch any *during* commit
@@ -274,44 +405,251 @@ auto Renderer::render(mg::RenderableList const& renderables) const -> std::uniqu
     return output;
 }
 
-miracle::Renderer::DrawData Renderer::draw(
-    mg::Renderable const& renderable,
-    DrawData const& data) const
+std::optional<geom::Rectangle> Renderer::find_redraw_area() const
 {
-    auto const texture = gl_interface->as_texture(renderable.buffer());
-    auto const clip_area = renderable.clip_area();
-    if (clip_area)
+    auto const border_config = config->get_border_config();
+
+    damage.begin_frame();
+    for (auto& item : draw_list)
     {
-        glEnable(GL_SCISSOR_TEST);
-        // The Y-coordinate is always relative to the top, so we make it relative to the bottom.
-        auto clip_y = viewport.top_left.y.as_int() + viewport.size.height.as_int()
-            - clip_area.value().top_left.y.as_int() - clip_area.value().size.height.as_int();
-        glm::vec4 clip_pos(clip_area.value().top_left.x.as_int(), clip_y, 0, 1);
-        clip_pos = display_transform * data.workspace_transform * clip_pos;
+        auto const outline_size = item.data.needs_outline ? std::max(border_config.size, 0) : 0;
+        item.content_bounds = get_bounds(*item.renderable, item.data, 0);
+        auto const outer_bounds = outline_size > 0
+            ? get_bounds(*item.renderable, item.data, outline_size)
+            : item.content_bounds;
+
+        // Allow for the rasterizer touching the pixels at the edges
+        item.bounds = grow(outer_bounds, 1);
+
+        DamageTracker::Element element {
+            item.renderable->id(),
+            item.renderable->buffer()->id().as_value(),
+            item.bounds,
+            item.renderable->alpha()
+        };
+        if (item.data.needs_outline && border_config.size > 0)
+        {
+            auto const color = item.data.is_focused ? border_config.focus_color : border_config.color;
+            element.outline_color = { color.r, color.g, color.b, color.a };
+        }
+        damage.add(element);
+    }
 
-        glScissor(
-            (int)clip_pos.x - viewport.top_left.x.as_int(),
-            (int)clip_pos.y,
-            clip_area.value().size.width.as_int(),
-            clip_area.value().size.height.as_int());
+    auto const area = damage.end_frame(is_rotated ? 0 : query_buffer_age());
+    if (!area)
+        return std::nullopt;
+    return intersection(area.value(), viewport);
+}
+
+glm::mat4 Renderer::get_model_matrix(mg::Renderable const& renderable, DrawData const& data) const
+{
+    // The renderable's own transformation is about its centre, as in the shader
+    auto const position = renderable.screen_position();
+    glm::vec3 const centre {
+        (float)position.top_left.x.as_int() + (float)position.size.width.as_int() / 2.f,
+        (float)position.top_left.y.as_int() + (float)position.size.height.as_int() / 2.f,
+        0.f
+    };
+    return data.output_transform
+        * data.workspace_transform
+        * glm::translate(glm::mat4(1.f), centre)
+        * renderable.transformation()
+        * glm::translate(glm::mat4(1.f), -centre);
+}
+
+geom::Rectangle Renderer::get_bounds(mg::Renderable const& renderable, DrawData const& data, int outline_size) const
+{
+    auto bounds = transformed_bounds(grow(renderable.screen_position(), outline_size), get_model_matrix(renderable, data));
+    if (auto const clip_area = renderable.clip_area())
+    {
+        auto const to_viewport = data.output_transform * data.workspace_transform;
+        bounds = intersection(bounds, transformed_bounds(grow(clip_area.value(), outline_size), to_viewport));
     }
 
-    // Resource: https://stackoverflow.com/questions/48246302/writing-to-the-opengl-stencil-buffer
-    if (data.outline_context.enabled)
+    return bounds;
+}
+
+void Renderer::tessellate_item(DrawItem& item) const
+{
+    primitives.clear();
+    tessellate(primitives, *item.renderable);
+    item.primitives = append_primitives();
+
+    // Outlines of clipped windows are drawn on their own rather than batched, see render()
+    auto const outline = get_outline_data(item.data);
+    if (outline.enabled && item.renderable->clip_area())
+    {
+        // Only the frame around the window is drawn, so the window beneath needs no masking
+        auto const size = outline.outline_context.size;
+        primitives.clear();
+        primitives.push_back(mgl::tessellate_frame(grow(item.renderable->screen_position(), size), size));
+        item.outline_primitives = append_primitives();
+    }
+    else
+    {
+        item.outline_primitives = {};
+    }
+}
+
+Renderer::PrimitiveRun Renderer::append_primitives() const
+{
+    PrimitiveRun run { frame_primitives.size(), primitives.size() };
+    for (auto const& p : primitives)
+    {
+        frame_primitives.push_back({ p.type, (GLint)frame_vertices.size(), p.nvertices });
+        frame_vertices.insert(frame_vertices.end(), p.vertices, p.vertices + p.nvertices);
+    }
+    return run;
+}
+
+void Renderer::add_border(mg::Renderable const& renderable, DrawData const& data) const
+{
+    border_batch.add(
+        get_model_matrix(renderable, data),
+        grow(renderable.screen_position(), data.outline_context.size),
+        data.outline_context.size,
+        data.outline_context.color);
+}
+
+void Renderer::draw_borders() const
+{
+    if (border_batch.empty())
+        return;
+
+    auto const& program = program_factory->get_border_program();
+    glUseProgram(program.id);
+    glUniformMatrix4fv(program.display_transform_uniform, 1, GL_FALSE,
+        glm::value_ptr(display_transform));
+    glUniformMatrix4fv(program.screen_to_gl_coords_uniform, 1, GL_FALSE,
+        glm::value_ptr(screen_to_gl_coords));
+
+    // The colors are premultiplied
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    auto const& vertices = border_batch.get_vertices();
+    border_vertex_buffer.upload(vertices);
+    glEnableVertexAttribArray(program.position_attr);
+    glEnableVertexAttribArray(program.color_attr);
+    glVertexAttribPointer(program.position_attr, 4, GL_FLOAT, GL_FALSE,
+        sizeof(BorderBatch::Vertex), reinterpret_cast<void const*>(offsetof(BorderBatch::Vertex, position)));
+    glVertexAttribPointer(program.color_attr, 4, GL_FLOAT, GL_FALSE,
+        sizeof(BorderBatch::Vertex), reinterpret_cast<void const*>(offsetof(BorderBatch::Vertex, color)));
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+
+    glDisableVertexAttribArray(program.color_attr);
+    glDisableVertexAttribArray(program.position_attr);
+    border_batch.clear();
+}
+
+uint64_t Renderer::cull_occluded(std::optional<geom::Rectangle> const& redraw_area) const
+{
+    // Walk from the top-most renderable down, so that each is tested against everything drawn over it
+    opaque_region.clear();
+    uint64_t culled = 0;
+    OpaqueRegion::Layer layer;
+    for (auto item = draw_list.rbegin(); item != draw_list.rend(); ++item)
     {
-        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-        glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+        auto const& renderable = *item->renderable;
+        layer.bounds = intersection(item->bounds, viewport);
+        layer.screen_position = renderable.screen_position();
+        layer.clip_area = renderable.clip_area();
+        layer.shaped = renderable.shaped();
+        layer.alpha = renderable.alpha();
+        layer.transformation = renderable.transformation();
+        layer.to_viewport = item->data.output_transform * item->data.workspace_transform;
+
+        item->occluded = opaque_region.cull(layer);
+
+        // Only what would have been drawn this frame counts as culled
+        if (item->occluded && (!redraw_area || area_of(intersection(item->bounds, redraw_area.value())) > 0))
+            culled++;
     }
-    else if (data.needs_outline)
+
+    return culled;
+}
+
+int Renderer::query_buffer_age() const
+{
+    if (!has_buffer_age)
+        return 0;
+
+    auto const display = eglGetCurrentDisplay();
+    auto const surface = eglGetCurrentSurface(EGL_DRAW);
+    EGLint age = 0;
+    if (display == EGL_NO_DISPLAY || surface == EGL_NO_SURFACE
+        || !eglQuerySurface(display, surface, EGL_BUFFER_AGE_EXT, &age))
+        return 0;
+    return age;
+}
+
+geom::Rectangle Renderer::to_framebuffer(geom::Rectangle const& area) const
+{
+    // Follows the vertex shader: into GL's normalised coordinates, then through the
+    // display transform, which both rotates the output and flips it when GL draws upside-down
+    float const left = (float)area.top_left.x.as_int();
+    float const top = (float)area.top_left.y.as_int();
+    float const right = left + (float)area.size.width.as_int();
+    float const bottom = top + (float)area.size.height.as_int();
+
+    glm::vec2 min { INFINITY, INFINITY };
+    glm::vec2 max { -INFINITY, -INFINITY };
+    for (auto const& corner : { glm::vec2 { left, top }, glm::vec2 { right, top }, glm::vec2 { left, bottom }, glm::vec2 { right, bottom } })
     {
-        glEnable(GL_STENCIL_TEST);
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
-        glStencilMask(0xFF);
-        glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
+        glm::vec4 const normalised {
+            2.f * (corner.x - (float)viewport.top_left.x.as_int()) / (float)viewport.size.width.as_int() - 1.f,
+            1.f - 2.f * (corner.y - (float)viewport.top_left.y.as_int()) / (float)viewport.size.height.as_int(),
+            0.f,
+            1.f
+        };
+        auto const point = glm::vec2(display_transform * normalised);
+        min = glm::min(min, point);
+        max = glm::max(max, point);
     }
+
+    // GL counts rows from the bottom of the viewport
+    float const scale_x = (float)gl_viewport.size.width.as_int() / 2.f;
+    float const scale_y = (float)gl_viewport.size.height.as_int() / 2.f;
+    auto const x = (int)floorf((min.x + 1.f) * scale_x);
+    auto const y = (int)floorf((min.y + 1.f) * scale_y);
+    return {
+        { gl_viewport.top_left.x.as_int() + x, gl_viewport.top_left.y.as_int() + y },
+        { (int)ceilf((max.x + 1.f) * scale_x) - x, (int)ceilf((max.y + 1.f) * scale_y) - y }
+    };
+}
+
+void Renderer::set_scissor(geom::Rectangle const& box) const
+{
+    auto const clipped = redraw_scissor ? intersection(box, redraw_scissor.value()) : box;
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(
+        clipped.top_left.x.as_int(),
+        clipped.top_left.y.as_int(),
+        clipped.size.width.as_int(),
+        clipped.size.height.as_int());
+}
+
+void Renderer::reset_scissor() const
+{
+    if (redraw_scissor)
+        set_scissor(redraw_scissor.value());
     else
+        glDisable(GL_SCISSOR_TEST);
+}
+
+miracle::Renderer::DrawData Renderer::draw(
+    mg::Renderable const& renderable,
+    DrawData const& data,
+    PrimitiveRun run) const
+{
+    auto const texture = gl_interface->as_texture(renderable.buffer());
+    auto const clip_area = renderable.clip_area();
+    if (clip_area)
     {
-        glDisable(GL_STENCIL_TEST);
+        // The clip area is in the workspace's logical coordinates, like the renderable
+        auto const to_viewport = data.output_transform * data.workspace_transform;
+        set_scissor(to_framebuffer(transformed_bounds(clip_area.value(), to_viewport)));
     }
 
     // All the programs are held by program_factory through its lifetime. Using pointers avoids
@@ -328,7 +666,15 @@ miracle::Renderer::DrawData Renderer::draw(
     }(renderable.alpha() < 1.0f);
 
     glUseProgram(prog->id);
-    if (prog->last_used_frameno != frameno)
+    bool const is_first_use_this_frame = prog->last_used_frameno != frameno;
+    if (is_first_use_this_frame || prog->last_output_transform != data.output_transform)
+    {
+        prog->last_output_transform = data.output_transform;
+        glUniformMatrix4fv(prog->output_transform_uniform, 1, GL_FALSE,
+            glm::value_ptr(data.output_transform));
+    }
+
+    if (is_first_use_this_frame)
     { // Avoid reloading the screen-global uniforms on every renderable
         // TODO: We actually only need to bind these *once*, right? Not once per frame?
         prog->last_used_frameno = frameno;
@@ -390,8 +736,18 @@ miracle::Renderer::DrawData Renderer::draw(
     if (has_texcoord_attr)
         glEnableVertexAttribArray(prog->texcoord_attr);
 
-    primitives.clear();
-    tessellate(primitives, renderable);
+    // The vertices were uploaded with the rest of the frame's, so primitives are only offsets into the buffer
+    vertex_buffer.bind();
+    glVertexAttribPointer(prog->position_attr, 3, GL_FLOAT,
+        GL_FALSE, sizeof(mgl::Vertex),
+        reinterpret_cast<void const*>(offsetof(mgl::Vertex, position)));
+
+    if (has_texcoord_attr)
+    {
+        glVertexAttribPointer(prog->texcoord_attr, 2, GL_FLOAT,
+            GL_FALSE, sizeof(mgl::Vertex),
+            reinterpret_cast<void const*>(offsetof(mgl::Vertex, texcoord)));
+    }
 
     // if we fail to load the texture, we need to carry on (part of lp:1629275)
     try
@@ -423,24 +779,14 @@ miracle::Renderer::DrawData Renderer::draw(
             glBlendColor(0.0f, 0.0f, 0.0f, renderable.alpha());
         }
 
-        for (auto const& p : primitives)
+        for (auto i = run.first; i < run.first + run.count; i++)
         {
+            auto const& p = frame_primitives[i];
             BlendSeparate blend;
 
             blend = client_blend;
             texture->bind();
 
-            glVertexAttribPointer(prog->position_attr, 3, GL_FLOAT,
-                GL_FALSE, sizeof(mgl::Vertex),
-                &p.vertices[0].position);
-
-            if (has_texcoord_attr)
-            {
-                glVertexAttribPointer(prog->texcoord_attr, 2, GL_FLOAT,
-                    GL_FALSE, sizeof(mgl::Vertex),
-                    &p.vertices[0].texcoord);
-            }
-
             if (blend.dst_rgb == GL_ZERO)
             {
                 glDisable(GL_BLEND);
@@ -452,7 +798,7 @@ miracle::Renderer::DrawData Renderer::draw(
                     blend.src_alpha, blend.dst_alpha);
             }
 
-            glDrawArrays(p.type, 0, p.nvertices);
+            glDrawArrays(p.type, p.first, p.count);
 
             // We're done with the texture for now
             texture->add_syncpoint();
@@ -467,11 +813,14 @@ miracle::Renderer::DrawData Renderer::draw(
 
     glDisableVertexAttribArray(prog->position_attr);
     if (renderable.clip_area())
-    {
-        glDisable(GL_SCISSOR_TEST);
-    }
+        reset_scissor();
 
     // Next, draw the outline if we have container to facilitate it
+    return get_outline_data(data);
+}
+
+miracle::Renderer::DrawData Renderer::get_outline_data(DrawData const& data) const
+{
     if (data.needs_outline)
     {
         auto border_config = config->get_border_config();
@@ -482,6 +831,7 @@ miracle::Renderer::DrawData Renderer::draw(
                 true,
                 false,
                 data.workspace_transform,
+                data.output_transform,
                 false,
                 { true,
                   color,
@@ -533,6 +883,7 @@ void Renderer::set_viewport(mir::geometry::Rectangle const& rect)
 
     viewport = rect;
     update_gl_viewport();
+    damage.damage_all();
 }
 
 void Renderer::update_gl_viewport()
@@ -563,6 +914,10 @@ void Renderer::update_gl_viewport()
         GLint offset_y = (output_height - reduced_height) / 2;
 
         glViewport(offset_x, offset_y, reduced_width, reduced_height);
+        gl_viewport = {
+            { offset_x, offset_y },
+            { reduced_width, reduced_height }
+        };
     }
 }
 
@@ -589,7 +944,9 @@ void Renderer::set_output_transform(glm::mat2 const& t)
     if (new_display_transform != display_transform)
     {
         display_transform = new_display_transform;
+        is_rotated = t != glm::mat2(1.f);
         update_gl_viewport();
+        damage.damage_all();
     }
 }
 
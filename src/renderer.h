@@ -18,9 +18,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIR_RENDERER_GL_RENDERER_H_
 #define MIR_RENDERER_GL_RENDERER_H_
 
+#include "border_batch.h"
+#include "damage_tracker.h"
+#include "opaque_region.h"
 #include "primitive.h"
 #include "program_factory.h"
+#include "renderer_statistics.h"
 #include "surface_tracker.h"
+#include "vertex_buffer.h"
+#include "window_snapshots.h"
 
 #include <GLES2/gl2.h>
 #include <mir/geometry/rectangle.h>
@@ -28,6 +34,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mir/graphics/renderable.h>
 #include <mir/renderer/renderer.h>
 #include <miral/window_manager_tools.h>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -54,8 +61,10 @@ public:
     Renderer(std::shared_ptr<mir::graphics::GLRenderingProvider> gl_interface,
         std::unique_ptr<mir::graphics::gl::OutputSurface> output,
         std::shared_ptr<MiracleConfig> const& config,
-        SurfaceTracker& surface_tracker);
-    ~Renderer() override = default;
+        SurfaceTracker& surface_tracker,
+        WindowSnapshots const& window_snapshots,
+        RendererStatistics& statistics);
+    ~Renderer() override;
 
     // These are called with a valid GL context:
     void set_viewport(mir::geometry::Rectangle const& rect) override;
@@ -65,6 +74,9 @@ public:
     // This is called _without_ a GL context:
     void suspend() override;
 
+    /// May be called from any thread.
+    [[nodiscard]] RendererStats get_stats() const;
+
 private:
     /**
      * tessellate defines the list of triangles that will be used to render
@@ -90,6 +102,10 @@ private:
         bool enabled = false;
         bool needs_outline = false;
         glm::mat4 workspace_transform = glm::mat4(1.f);
+
+        /// Shared by every window on an output, so that moving the output,
+        /// as the workspace switch animation does, is a single uniform.
+        glm::mat4 output_transform = glm::mat4(1.f);
         bool is_focused = false;
 
         struct
@@ -100,23 +116,113 @@ private:
         } outline_context;
     };
 
+    /// A primitive whose vertices are in [vertex_buffer]
+    struct BufferedPrimitive
+    {
+        GLenum type;
+        GLint first;
+        GLsizei count;
+    };
+
+    /// A run of consecutive [frame_primitives]
+    struct PrimitiveRun
+    {
+        size_t first = 0;
+        size_t count = 0;
+    };
+
+    struct DrawItem
+    {
+        std::shared_ptr<mir::graphics::Renderable const> renderable;
+        DrawData data;
+
+        /// The area drawn to, including the outline, in the viewport's logical coordinates
+        mir::geometry::Rectangle bounds;
+
+        /// The area drawn to by the renderable alone
+        mir::geometry::Rectangle content_bounds;
+
+        /// Hidden behind opaque renderables drawn after it
+        bool occluded = false;
+
+        /// Whether the item is drawn this frame, in which case its primitives are set
+        bool drawn = false;
+        PrimitiveRun primitives;
+
+        /// The outline's primitives, when it is drawn on its own rather than batched
+        PrimitiveRun outline_primitives;
+    };
+
     DrawData get_draw_data(mir::graphics::Renderable const&) const;
-    /// Draws the current renderable and returns a follow-up draw if required.
-    DrawData draw(mir::graphics::Renderable const& renderable, DrawData const& data) const;
+    /// Draws the current renderable from the [frame_primitives] in [run] and
+    /// returns a follow-up draw if required.
+    DrawData draw(mir::graphics::Renderable const& renderable, DrawData const& data, PrimitiveRun run) const;
+    /// The follow-up draw for the outline of a renderable drawn with [data], if it has one.
+    DrawData get_outline_data(DrawData const& data) const;
+
+    /// Tessellates [item] into [frame_vertices].
+    void tessellate_item(DrawItem& item) const;
+    /// Moves [primitives] into [frame_vertices] and [frame_primitives].
+    PrimitiveRun append_primitives() const;
     void update_gl_viewport();
 
+    /// Records this frame's [draw_list] with [damage] and returns the area that
+    /// must be redrawn, or std::nullopt if the whole output must be.
+    std::optional<mir::geometry::Rectangle> find_redraw_area() const;
+    /// The transformation from the renderable's own coordinates to the viewport's logical coordinates
+    glm::mat4 get_model_matrix(mir::graphics::Renderable const&, DrawData const&) const;
+    mir::geometry::Rectangle get_bounds(mir::graphics::Renderable const&, DrawData const&, int outline_size) const;
+    int query_buffer_age() const;
+
+    /// Marks the items of [draw_list] that are hidden. Returns how many of them
+    /// would otherwise have been drawn into [redraw_area], or anywhere when it is unset.
+    uint64_t cull_occluded(std::optional<mir::geometry::Rectangle> const& redraw_area) const;
+
+    /// Maps an area in the viewport's logical coordinates to a scissor box in the framebuffer.
+    mir::geometry::Rectangle to_framebuffer(mir::geometry::Rectangle const&) const;
+    /// Scissors to [box], within the area being redrawn this frame.
+    void set_scissor(mir::geometry::Rectangle const& box) const;
+    /// Scissors back to the area being redrawn this frame, if any.
+    void reset_scissor() const;
+
+    /// Queues the outline described by [data] around [renderable] in [border_batch].
+    void add_border(mir::graphics::Renderable const& renderable, DrawData const& data) const;
+    /// Draws and empties [border_batch].
+    void draw_borders() const;
     std::unique_ptr<mir::graphics::gl::OutputSurface> const output_surface;
     GLfloat clear_color[4];
-    bool has_stencil_support = false;
     mutable long long frameno = 0;
     std::unique_ptr<ProgramFactory> const program_factory;
     mir::geometry::Rectangle viewport;
     glm::mat4 screen_to_gl_coords;
     glm::mat4 display_transform;
+
+    /// Only upright outputs are partially redrawn, so that damage stays a single scissor box.
+    bool is_rotated = false;
+
+    /// The rectangle last given to glViewport
+    mir::geometry::Rectangle gl_viewport;
+    bool has_buffer_age = false;
+    DamageTracker mutable damage;
+    std::vector<DrawItem> mutable draw_list;
+    OpaqueRegion mutable opaque_region;
+    BorderBatch mutable border_batch;
+
+    /// The part of the framebuffer being redrawn this frame, if not all of it
+    std::optional<mir::geometry::Rectangle> mutable redraw_scissor;
+
     std::vector<mir::gl::Primitive> mutable primitives;
+
+    /// The vertices of every primitive drawn in a frame, uploaded to [vertex_buffer] at once
+    std::vector<mir::gl::Vertex> mutable frame_vertices;
+    std::vector<BufferedPrimitive> mutable frame_primitives;
+    VertexBuffer mutable vertex_buffer;
+    VertexBuffer mutable border_vertex_buffer;
     std::shared_ptr<mir::graphics::GLRenderingProvider> const gl_interface;
     std::shared_ptr<MiracleConfig> config;
     SurfaceTracker& surface_tracker;
+    WindowSnapshots const& window_snapshots;
+    RendererStatistics& statistics;
 };
 
 }
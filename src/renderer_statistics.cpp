@@ -0,0 +1,69 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "renderer_statistics.h"
+
+using namespace miracle;
+
+void RendererStatistics::add_frame(void const* renderer, uint64_t pixels_redrawn, uint64_t culled_draws)
+{
+    std::lock_guard lock(mutex);
+    auto& stats = renderers[renderer];
+    stats.frames++;
+    stats.pixels_redrawn += pixels_redrawn;
+    stats.last_frame_pixels_redrawn = pixels_redrawn;
+    stats.culled_draws += culled_draws;
+    stats.last_frame_culled_draws = culled_draws;
+}
+
+void RendererStatistics::remove(void const* renderer)
+{
+    std::lock_guard lock(mutex);
+    auto it = renderers.find(renderer);
+    if (it == renderers.end())
+        return;
+
+    removed.frames += it->second.frames;
+    removed.pixels_redrawn += it->second.pixels_redrawn;
+    removed.culled_draws += it->second.culled_draws;
+    renderers.erase(it);
+}
+
+RendererStats RendererStatistics::get(void const* renderer) const
+{
+    std::lock_guard lock(mutex);
+    auto it = renderers.find(renderer);
+    if (it == renderers.end())
+        return {};
+
+    return it->second;
+}
+
+RendererStats RendererStatistics::get() const
+{
+    std::lock_guard lock(mutex);
+    auto total = removed;
+    for (auto const& [renderer, stats] : renderers)
+    {
+        total.frames += stats.frames;
+        total.pixels_redrawn += stats.pixels_redrawn;
+        total.last_frame_pixels_redrawn += stats.last_frame_pixels_redrawn;
+        total.culled_draws += stats.culled_draws;
+        total.last_frame_culled_draws += stats.last_frame_culled_draws;
+    }
+    return total;
+}
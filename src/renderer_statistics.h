@@ -0,0 +1,69 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_RENDERER_STATISTICS_H
+#define MIRACLEWM_RENDERER_STATISTICS_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace miracle
+{
+
+/// Counts how much of its output a [Renderer] has redrawn.
+struct RendererStats
+{
+    uint64_t frames = 0;
+
+    /// Framebuffer pixels, so that a scaled output counts every physical pixel
+    uint64_t pixels_redrawn = 0;
+    uint64_t last_frame_pixels_redrawn = 0;
+
+    /// Renderables that were not drawn because opaque renderables above hid them
+    uint64_t culled_draws = 0;
+    uint64_t last_frame_culled_draws = 0;
+};
+
+/// Collects the [RendererStats] of every output's [Renderer], so that they can
+/// be read while the compositor runs. The renderers report each frame from
+/// their own threads, and the totals may be read from any thread.
+class RendererStatistics
+{
+public:
+    /// Records a frame drawn by [renderer].
+    void add_frame(void const* renderer, uint64_t pixels_redrawn, uint64_t culled_draws);
+
+    /// Forgets [renderer], whose frames stay counted in the totals.
+    void remove(void const* renderer);
+
+    /// The stats of a single renderer, which are empty if it has drawn nothing.
+    [[nodiscard]] RendererStats get(void const* renderer) const;
+
+    /// The stats of every renderer added together. The last frame counts are
+    /// those of the renderers that are still drawing.
+    [[nodiscard]] RendererStats get() const;
+
+private:
+    mutable std::mutex mutex;
+    std::map<void const*, RendererStats> renderers;
+    RendererStats removed;
+};
+
+}
+
+#endif // MIRACLEWM_RENDERER_STATISTICS_H
@@ -57,3 +57,57 @@ mgl::Primitive mgl::tessellate_renderable_into_rectangle(
     };
     return rectangle;
 }
+
+mgl::Primitive mgl::tessellate_frame(geom::Rectangle const& outer, int width)
+{
+    GLfloat const left = outer.top_left.x.as_int();
+    GLfloat const right = left + outer.size.width.as_int();
+    GLfloat const top = outer.top_left.y.as_int();
+    GLfloat const bottom = top + outer.size.height.as_int();
+    GLfloat const inner_left = left + width;
+    GLfloat const inner_right = right - width;
+    GLfloat const inner_top = top + width;
+    GLfloat const inner_bottom = bottom - width;
+
+    mgl::Primitive frame;
+    frame.type = GL_TRIANGLE_STRIP;
+    frame.nvertices = 10;
+
+    // Alternate between the outer and inner corners all the way around, back to the start
+    auto& vertices = frame.vertices;
+    vertices[0] = {
+        { left, top, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[1] = {
+        { inner_left, inner_top, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[2] = {
+        { right, top, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[3] = {
+        { inner_right, inner_top, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[4] = {
+        { right, bottom, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[5] = {
+        { inner_right, inner_bottom, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[6] = {
+        { left, bottom, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[7] = {
+        { inner_left, inner_bottom, 0.0f },
+        { 0.0f, 0.0f }
+    };
+    vertices[8] = vertices[0];
+    vertices[9] = vertices[1];
+    return frame;
+}
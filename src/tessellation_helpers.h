@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MIR_GL_TESSELLATION_HELPERS_H_
 #define MIR_GL_TESSELLATION_HELPERS_H_
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangle.h"
 #include "primitive.h"
 
 namespace mir
@@ -32,6 +33,10 @@ namespace gl
     Primitive tessellate_renderable_into_rectangle(
         graphics::Renderable const& renderable, geometry::Displacement const& offset);
 
+    /// Tessellates the frame of [width] just inside of [outer] into a single
+    /// triangle strip, leaving the area that it surrounds untouched.
+    Primitive tessellate_frame(geometry::Rectangle const& outer, int width);
+
 }
 }
 #endif /* MIR_GL_TESSELLATION_HELPERS_H_ */
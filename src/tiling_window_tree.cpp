@@ -710,6 +710,11 @@ void TilingWindowTree::foreach_node(std::function<void(std::shared_ptr<Container
         root_lane);
 }
 
+std::shared_ptr<Container> TilingWindowTree::find_node(std::function<bool(std::shared_ptr<Container>)> const& f)
+{
+    return foreach_node_internal(f, root_lane);
+}
+
 void TilingWindowTree::hide()
 {
     if (is_hidden)
@@ -116,6 +116,9 @@ public:
 
     void foreach_node(std::function<void(std::shared_ptr<Container>)> const&);
 
+    /// Returns the first node, in the order of [foreach_node], for which [f] returns true
+    std::shared_ptr<Container> find_node(std::function<bool(std::shared_ptr<Container>)> const& f);
+
     /// Shows the containers in this tree and returns a fullscreen container, if any
     std::shared_ptr<LeafContainer> show();
 
@@ -126,6 +129,7 @@ public:
     bool is_empty();
 
     Workspace* get_workspace() const;
+    [[nodiscard]] std::shared_ptr<ParentContainer> const& get_root() const { return root_lane; }
 
 private:
     struct MoveResult
@@ -0,0 +1,46 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_TREE_GENERATION_H
+#define MIRACLEWM_TREE_GENERATION_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace miracle
+{
+
+/// A global, monotonically increasing counter that is bumped whenever
+/// an [Output] or [Workspace] changes in a way that is visible to IPC
+/// clients. Each object records the generation at which it last changed,
+/// so that serialized copies of it can be reused until it changes again.
+class TreeGeneration
+{
+public:
+    /// Returns a generation that is newer than any returned before it.
+    static uint64_t next() { return ++counter; }
+
+    /// The most recent generation that has been handed out.
+    static uint64_t current() { return counter; }
+
+private:
+    static inline std::atomic<uint64_t> counter = 0;
+};
+
+}
+
+#endif // MIRACLEWM_TREE_GENERATION_H
@@ -0,0 +1,58 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "vertex_buffer.h"
+
+using namespace miracle;
+
+namespace
+{
+/// Leaves room to grow, so that the storage is not reallocated every time a window opens
+size_t grow_capacity(size_t capacity, size_t size)
+{
+    if (capacity == 0)
+        capacity = 4096;
+    while (capacity < size)
+        capacity *= 2;
+    return capacity;
+}
+}
+
+VertexBuffer::~VertexBuffer()
+{
+    if (id)
+        glDeleteBuffers(1, &id);
+}
+
+void VertexBuffer::upload(void const* data, size_t size)
+{
+    if (!id)
+        glGenBuffers(1, &id);
+
+    glBindBuffer(GL_ARRAY_BUFFER, id);
+    capacity = grow_capacity(capacity, size);
+
+    // Passing no data orphans the old storage rather than synchronizing with draws still using it
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity, nullptr, GL_STREAM_DRAW);
+    if (size > 0)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)size, data);
+}
+
+void VertexBuffer::bind() const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, id);
+}
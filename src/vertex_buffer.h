@@ -0,0 +1,66 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_VERTEX_BUFFER_H
+#define MIRACLEWM_VERTEX_BUFFER_H
+
+#include <GLES2/gl2.h>
+#include <cstddef>
+#include <vector>
+
+namespace miracle
+{
+
+/// A GL array buffer that is refilled with new vertices every frame.
+///
+/// The vertices are gathered on the CPU and uploaded in one go, after which
+/// draws only refer to offsets within the buffer. Each upload orphans the
+/// previous storage, which the GPU may still be reading from, so that the
+/// driver can hand out fresh memory instead of waiting for it.
+///
+/// Must only be used, and destroyed, with the same GL context current.
+class VertexBuffer
+{
+public:
+    VertexBuffer() = default;
+    ~VertexBuffer();
+
+    VertexBuffer(VertexBuffer const&) = delete;
+    VertexBuffer& operator=(VertexBuffer const&) = delete;
+
+    /// Replaces the contents of the buffer and leaves it bound to GL_ARRAY_BUFFER.
+    template <typename Vertex>
+    void upload(std::vector<Vertex> const& vertices)
+    {
+        upload(vertices.data(), vertices.size() * sizeof(Vertex));
+    }
+
+    void upload(void const* data, size_t size);
+
+    /// Binds the buffer to GL_ARRAY_BUFFER.
+    void bind() const;
+
+private:
+    GLuint id = 0;
+
+    /// The size of the buffer's storage, which only ever grows
+    size_t capacity = 0;
+};
+
+}
+
+#endif // MIRACLEWM_VERTEX_BUFFER_H
@@ -52,6 +52,38 @@ public:
     virtual void set_user_data(miral::Window const&, std::shared_ptr<void> const&) = 0;
     virtual void modify(miral::Window const&, miral::WindowSpecification const&) = 0;
     virtual miral::WindowInfo& info_for(miral::Window const&) = 0;
+
+    /// Starts a batch of changes. Until the matching [end_batch], calls to
+    /// [set_rectangle] may be deferred and coalesced per window so that the
+    /// whole batch reaches the screen at once. Batches may be nested.
+    virtual void begin_batch() = 0;
+
+    /// Ends a batch of changes. When the outermost batch ends, any deferred
+    /// changes are applied.
+    virtual void end_batch() = 0;
+};
+
+/// Holds a batch open on a [WindowController] for as long as it is in scope,
+/// so that the batch is ended even when a change in it throws.
+class WindowControllerBatch
+{
+public:
+    explicit WindowControllerBatch(WindowController& window_controller) :
+        window_controller { window_controller }
+    {
+        window_controller.begin_batch();
+    }
+
+    ~WindowControllerBatch()
+    {
+        window_controller.end_batch();
+    }
+
+    WindowControllerBatch(WindowControllerBatch const&) = delete;
+    WindowControllerBatch& operator=(WindowControllerBatch const&) = delete;
+
+private:
+    WindowController& window_controller;
 };
 
 }
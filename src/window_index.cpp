@@ -0,0 +1,123 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "window_index.h"
+#include <algorithm>
+
+using namespace miracle;
+
+void WindowIndex::add(uint64_t id, std::weak_ptr<Container> const& container, std::string const& title, std::string const& app_id)
+{
+    remove(id);
+    auto const sequence = next_sequence++;
+    entries[id] = { container, title, app_id, sequence };
+    ids_by_sequence.emplace(sequence, id);
+    by_title.emplace(title, id);
+    by_app_id.emplace(app_id, id);
+}
+
+void WindowIndex::remove(uint64_t id)
+{
+    auto it = entries.find(id);
+    if (it == entries.end())
+        return;
+
+    erase(by_title, it->second.title, id);
+    erase(by_app_id, it->second.app_id, id);
+    ids_by_sequence.erase(it->second.sequence);
+    entries.erase(it);
+}
+
+void WindowIndex::update(uint64_t id, std::string const& title, std::string const& app_id)
+{
+    auto it = entries.find(id);
+    if (it == entries.end())
+        return;
+
+    auto& entry = it->second;
+    if (entry.title != title)
+    {
+        erase(by_title, entry.title, id);
+        entry.title = title;
+        by_title.emplace(title, id);
+    }
+
+    if (entry.app_id != app_id)
+    {
+        erase(by_app_id, entry.app_id, id);
+        entry.app_id = app_id;
+        by_app_id.emplace(app_id, id);
+    }
+}
+
+std::shared_ptr<Container> WindowIndex::get(uint64_t id) const
+{
+    auto it = entries.find(id);
+    if (it == entries.end())
+        return nullptr;
+
+    return it->second.container.lock();
+}
+
+bool WindowIndex::contains(uint64_t id) const
+{
+    return entries.contains(id);
+}
+
+std::vector<uint64_t> WindowIndex::find_by_title(std::string const& title) const
+{
+    return find(by_title, title);
+}
+
+std::vector<uint64_t> WindowIndex::find_by_app_id(std::string const& app_id) const
+{
+    return find(by_app_id, app_id);
+}
+
+void WindowIndex::for_each(std::function<void(uint64_t)> const& f) const
+{
+    for (auto const& [sequence, id] : ids_by_sequence)
+        f(id);
+}
+
+void WindowIndex::erase(Lookup& lookup, std::string const& key, uint64_t id)
+{
+    auto [begin, end] = lookup.equal_range(key);
+    for (auto it = begin; it != end; it++)
+    {
+        if (it->second == id)
+        {
+            lookup.erase(it);
+            return;
+        }
+    }
+}
+
+std::vector<uint64_t> WindowIndex::find(Lookup const& lookup, std::string const& key) const
+{
+    std::vector<uint64_t> result;
+    auto [begin, end] = lookup.equal_range(key);
+    for (auto it = begin; it != end; it++)
+        result.push_back(it->second);
+
+    // The multimap keeps no useful order of its own
+    std::sort(result.begin(), result.end(), [&](uint64_t a, uint64_t b)
+    {
+        return entries.at(a).sequence < entries.at(b).sequence;
+    });
+    return result;
+}
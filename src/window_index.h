@@ -0,0 +1,84 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_WINDOW_INDEX_H
+#define MIRACLEWM_WINDOW_INDEX_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace miracle
+{
+class Container;
+
+/// Indexes every managed window by con_id, title and app_id so that i3
+/// criteria can be resolved without walking every application.
+///
+/// The index is kept up to date as windows are opened, closed and renamed.
+/// Lookups list windows in the order that they were added, so that commands
+/// acting on the last match behave the same every time.
+/// Workspace membership is not indexed here, because each [Workspace]
+/// already knows its own windows.
+class WindowIndex
+{
+public:
+    void add(uint64_t id, std::weak_ptr<Container> const& container, std::string const& title, std::string const& app_id);
+    void remove(uint64_t id);
+
+    /// Updates the title and app_id of [id], if it is indexed.
+    void update(uint64_t id, std::string const& title, std::string const& app_id);
+
+    [[nodiscard]] std::shared_ptr<Container> get(uint64_t id) const;
+    [[nodiscard]] bool contains(uint64_t id) const;
+    [[nodiscard]] std::vector<uint64_t> find_by_title(std::string const& title) const;
+    [[nodiscard]] std::vector<uint64_t> find_by_app_id(std::string const& app_id) const;
+    [[nodiscard]] size_t size() const { return entries.size(); }
+
+    /// Calls [f] with the id of every indexed window, in the order that they were added.
+    void for_each(std::function<void(uint64_t)> const& f) const;
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<Container> container;
+        std::string title;
+        std::string app_id;
+
+        /// Increases with every window that is added
+        uint64_t sequence = 0;
+    };
+
+    using Lookup = std::unordered_multimap<std::string, uint64_t>;
+
+    static void erase(Lookup& lookup, std::string const& key, uint64_t id);
+    std::vector<uint64_t> find(Lookup const& lookup, std::string const& key) const;
+
+    std::unordered_map<uint64_t, Entry> entries;
+    std::map<uint64_t, uint64_t> ids_by_sequence;
+    uint64_t next_sequence = 0;
+    Lookup by_title;
+    Lookup by_app_id;
+};
+
+}
+
+#endif // MIRACLEWM_WINDOW_INDEX_H
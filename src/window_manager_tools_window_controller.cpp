@@ -72,7 +72,81 @@ void WindowManagerToolsWindowController::set_rectangle(
         return;
     }
 
-    animator.window_move(
+    if (batch_depth > 0)
+    {
+        // Only the first starting point and the last destination of a window matter,
+        // so a window that is moved several times in a batch is animated only once.
+        for (auto& pending : pending_moves)
+        {
+            if (pending.window == window)
+            {
+                pending.to = to;
+                return;
+            }
+        }
+
+        pending_moves.push_back({ window, from, to });
+        return;
+    }
+
+    move(window, from, to);
+}
+
+void WindowManagerToolsWindowController::begin_batch()
+{
+    batch_depth++;
+}
+
+void WindowManagerToolsWindowController::end_batch()
+{
+    if (batch_depth == 0)
+    {
+        mir::log_error("end_batch: called without a matching begin_batch");
+        return;
+    }
+
+    if (--batch_depth > 0)
+        return;
+
+    // The whole batch is handed to the animator as one group, so that the
+    // windows start together and the animator is only locked once
+    auto pending = std::move(pending_moves);
+    pending_moves.clear();
+
+    std::vector<WindowMove> moves;
+    moves.reserve(pending.size());
+    for (auto const& move : pending)
+    {
+        // The window may have been closed by a later change in the batch, in
+        // which case Mir no longer has any info for it
+        auto surface = move.window.operator std::shared_ptr<mir::scene::Surface>();
+        if (!surface)
+            continue;
+
+        auto container = get_container(move.window);
+        if (!container)
+            continue;
+
+        moves.push_back(make_move(move.window, container, move.from, move.to));
+    }
+
+    animator.window_moves(moves);
+}
+
+void WindowManagerToolsWindowController::move(
+    miral::Window const& window, geom::Rectangle const& from, geom::Rectangle const& to)
+{
+    auto move = make_move(window, get_container(window), from, to);
+    animator.window_move(move.handle, move.from, move.to, move.current, move.callback);
+}
+
+WindowMove WindowManagerToolsWindowController::make_move(
+    miral::Window const& window,
+    std::shared_ptr<Container> const& container,
+    geom::Rectangle const& from,
+    geom::Rectangle const& to)
+{
+    return {
         container->animation_handle(),
         from,
         to,
@@ -80,7 +154,8 @@ void WindowManagerToolsWindowController::set_rectangle(
         [this, container = container](miracle::AnimationStepResult const& result)
     {
         on_animation(result, container);
-    });
+    }
+    };
 }
 
 MirWindowState WindowManagerToolsWindowController::get_state(miral::Window const& window)
@@ -20,11 +20,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "window_controller.h"
 #include <miral/window_manager_tools.h>
+#include <vector>
 
 namespace miracle
 {
 class Animator;
 class CompositorState;
+struct WindowMove;
 
 class WindowManagerToolsWindowController : public WindowController
 {
@@ -49,11 +51,29 @@ public:
     void modify(miral::Window const&, miral::WindowSpecification const&) override;
     miral::WindowInfo& info_for(miral::Window const&) override;
     void close(miral::Window const& window) override;
+    void begin_batch() override;
+    void end_batch() override;
 
 private:
+    struct PendingMove
+    {
+        miral::Window window;
+        geom::Rectangle from;
+        geom::Rectangle to;
+    };
+
+    void move(miral::Window const&, geom::Rectangle const& from, geom::Rectangle const& to);
+    WindowMove make_move(
+        miral::Window const&,
+        std::shared_ptr<Container> const&,
+        geom::Rectangle const& from,
+        geom::Rectangle const& to);
+
     miral::WindowManagerTools tools;
     Animator& animator;
     CompositorState& state;
+    int batch_depth = 0;
+    std::vector<PendingMove> pending_moves;
 };
 }
 
@@ -0,0 +1,211 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "window_snapshots.h"
+#include <algorithm>
+#include <mir/graphics/buffer.h>
+
+using namespace miracle;
+
+namespace
+{
+/// Buffers are assumed to hold four bytes per pixel
+constexpr size_t bytes_per_pixel = 4;
+
+size_t estimate_bytes(mir::graphics::Renderable const& renderable)
+{
+    auto const buffer = renderable.buffer();
+    if (!buffer)
+        return 0;
+
+    auto const size = buffer->size();
+    return static_cast<size_t>(size.width.as_int()) * static_cast<size_t>(size.height.as_int()) * bytes_per_pixel;
+}
+}
+
+/// A copy of a surface's renderable that keeps its buffer alive, and so
+/// can still be drawn after the surface has been destroyed.
+class WindowSnapshots::SnapshotRenderable : public mir::graphics::Renderable
+{
+public:
+    explicit SnapshotRenderable(mir::graphics::Renderable const& renderable) :
+        _buffer { renderable.buffer() },
+        _screen_position { renderable.screen_position() },
+        _src_bounds { renderable.src_bounds() },
+        _clip_area { renderable.clip_area() },
+        base_alpha { renderable.alpha() },
+        base_transformation { renderable.transformation() },
+        _shaped { renderable.shaped() },
+        _alpha { base_alpha },
+        _transformation { base_transformation }
+    {
+    }
+
+    [[nodiscard]] ID id() const override
+    {
+        return this;
+    }
+
+    [[nodiscard]] std::shared_ptr<mir::graphics::Buffer> buffer() const override
+    {
+        return _buffer;
+    }
+
+    [[nodiscard]] mir::geometry::Rectangle screen_position() const override
+    {
+        return _screen_position;
+    }
+
+    [[nodiscard]] mir::geometry::RectangleD src_bounds() const override
+    {
+        return _src_bounds;
+    }
+
+    [[nodiscard]] std::optional<mir::geometry::Rectangle> clip_area() const override
+    {
+        return _clip_area;
+    }
+
+    [[nodiscard]] float alpha() const override
+    {
+        return _alpha;
+    }
+
+    [[nodiscard]] glm::mat4 transformation() const override
+    {
+        return _transformation;
+    }
+
+    [[nodiscard]] bool shaped() const override
+    {
+        return _shaped;
+    }
+
+    /// The surface is gone, so there is none to report
+    [[nodiscard]] std::optional<mir::scene::Surface const*> surface_if_any() const override
+    {
+        return {};
+    }
+
+    /// A copy of this renderable with a step of the close animation applied
+    [[nodiscard]] std::shared_ptr<SnapshotRenderable const> with(AnimationStepResult const& result) const
+    {
+        auto next = std::make_shared<SnapshotRenderable>(*this);
+        if (result.transform)
+            next->_transformation = result.transform.value() * base_transformation;
+        if (result.alpha)
+            next->_alpha = base_alpha * std::clamp(result.alpha.value(), 0.f, 1.f);
+        return next;
+    }
+
+private:
+    std::shared_ptr<mir::graphics::Buffer> const _buffer;
+    mir::geometry::Rectangle const _screen_position;
+    mir::geometry::RectangleD const _src_bounds;
+    std::optional<mir::geometry::Rectangle> const _clip_area;
+    float const base_alpha;
+    glm::mat4 const base_transformation;
+    bool const _shaped;
+    float _alpha;
+    glm::mat4 _transformation;
+};
+
+bool WindowSnapshots::add(
+    AnimationHandle handle,
+    mir::graphics::RenderableList const& renderables,
+    glm::mat4 const& workspace_transform,
+    size_t memory_limit)
+{
+    Snapshot snapshot { handle, {}, workspace_transform, 0 };
+    for (auto const& renderable : renderables)
+    {
+        if (!renderable->buffer())
+            continue;
+
+        snapshot.bytes += estimate_bytes(*renderable);
+        snapshot.renderables.push_back(std::make_shared<SnapshotRenderable>(*renderable));
+    }
+
+    if (snapshot.renderables.empty() || snapshot.bytes > memory_limit)
+        return false;
+
+    std::lock_guard lock(mutex);
+
+    // A handle has at most one snapshot
+    std::erase_if(snapshots, [&](Snapshot const& other)
+    {
+        if (other.handle != handle)
+            return false;
+        bytes_used -= other.bytes;
+        return true;
+    });
+
+    // Make room by letting go of the snapshots that have been closing the longest
+    size_t evict = 0;
+    while (bytes_used + snapshot.bytes > memory_limit)
+        bytes_used -= snapshots[evict++].bytes;
+    snapshots.erase(snapshots.begin(), snapshots.begin() + evict);
+
+    bytes_used += snapshot.bytes;
+    snapshots.push_back(std::move(snapshot));
+    return true;
+}
+
+void WindowSnapshots::on_animation(AnimationStepResult const& result)
+{
+    std::lock_guard lock(mutex);
+    auto it = std::find_if(snapshots.begin(), snapshots.end(), [&](Snapshot const& snapshot)
+    {
+        return snapshot.handle == result.handle;
+    });
+
+    // The snapshot may already have been evicted
+    if (it == snapshots.end())
+        return;
+
+    if (result.is_complete)
+    {
+        bytes_used -= it->bytes;
+        snapshots.erase(it);
+        return;
+    }
+
+    for (auto& renderable : it->renderables)
+        renderable = renderable->with(result);
+}
+
+void WindowSnapshots::for_each(std::function<void(std::shared_ptr<mir::graphics::Renderable const> const&, glm::mat4 const&)> const& f) const
+{
+    std::lock_guard lock(mutex);
+    for (auto const& snapshot : snapshots)
+    {
+        for (auto const& renderable : snapshot.renderables)
+            f(renderable, snapshot.workspace_transform);
+    }
+}
+
+size_t WindowSnapshots::size() const
+{
+    std::lock_guard lock(mutex);
+    return snapshots.size();
+}
+
+size_t WindowSnapshots::memory_used() const
+{
+    std::lock_guard lock(mutex);
+    return bytes_used;
+}
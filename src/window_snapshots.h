@@ -0,0 +1,85 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef MIRACLEWM_WINDOW_SNAPSHOTS_H
+#define MIRACLEWM_WINDOW_SNAPSHOTS_H
+
+#include "animator.h"
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mir/graphics/renderable.h>
+#include <mutex>
+#include <vector>
+
+namespace miracle
+{
+
+/// Keeps what windows last showed after they have closed, so that their
+/// close animations can play once their surfaces are gone. The [Policy]
+/// adds a snapshot when a window is deleted and feeds it the steps of its
+/// close animation, while each [Renderer] draws the snapshots over the scene.
+///
+/// A snapshot holds on to its window's last buffers, so the snapshots are
+/// kept within a memory limit by dropping the oldest ones first.
+class WindowSnapshots
+{
+public:
+    /// Captures [renderables], the last frame of the window animated by
+    /// [handle], drawn with [workspace_transform]. Returns false if there
+    /// is nothing to capture or if the snapshot alone would exceed
+    /// [memory_limit] bytes, in which case nothing is kept.
+    bool add(
+        AnimationHandle handle,
+        mir::graphics::RenderableList const& renderables,
+        glm::mat4 const& workspace_transform,
+        size_t memory_limit);
+
+    /// Applies a step of the close animation to the snapshot for the result's
+    /// handle, dropping the snapshot once the animation has completed.
+    void on_animation(AnimationStepResult const& result);
+
+    /// Calls [f] with each renderable of each snapshot, oldest first, along
+    /// with the workspace transform that it is drawn with. The renderables
+    /// never change, as animation steps replace them instead, so they may be
+    /// held on to and drawn after [f] returns.
+    void for_each(std::function<void(std::shared_ptr<mir::graphics::Renderable const> const&, glm::mat4 const&)> const& f) const;
+
+    [[nodiscard]] size_t size() const;
+
+    /// An estimate of the memory held by the snapshots' buffers, in bytes.
+    [[nodiscard]] size_t memory_used() const;
+
+private:
+    class SnapshotRenderable;
+
+    struct Snapshot
+    {
+        AnimationHandle handle;
+        std::vector<std::shared_ptr<SnapshotRenderable const>> renderables;
+        glm::mat4 workspace_transform;
+        size_t bytes;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Snapshot> snapshots;
+    size_t bytes_used = 0;
+};
+
+}
+
+#endif // MIRACLEWM_WINDOW_SNAPSHOTS_H
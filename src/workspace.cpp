@@ -96,11 +96,13 @@ int Workspace::get_workspace() const
 void Workspace::set_area(mir::geometry::Rectangle const& area)
 {
     tree->set_area(area);
+    mark_dirty();
 }
 
 void Workspace::recalculate_area()
 {
     tree->recalculate_root_node_area();
+    mark_dirty();
 }
 
 ContainerType Workspace::allocate_position(
@@ -172,6 +174,8 @@ std::shared_ptr<Container> Workspace::create_container(
     {
         tree->advise_fullscreen_container(*Container::as_leaf(container));
     }
+
+    mark_dirty();
     return container;
 }
 
@@ -208,6 +212,8 @@ void Workspace::delete_container(std::shared_ptr<Container> const &container)
         mir::log_error("Unsupported window type: %d", (int)container->get_type());
         return;
     }
+
+    mark_dirty();
 }
 
 void Workspace::show()
@@ -391,7 +397,9 @@ void Workspace::transfer_pinned_windows_to(std::shared_ptr<Workspace> const& oth
         if (floating && floating->pinned())
         {
             other->floating_windows.push_back(floating);
+            other->mark_dirty();
             it = floating_windows.erase(it);
+            mark_dirty();
         }
         else
             it++;
@@ -414,6 +422,7 @@ std::shared_ptr<FloatingContainer> Workspace::add_floating_window(miral::Window
     auto floating = std::make_shared<FloatingContainer>(
         window, floating_window_manager, window_controller, this, state);
     floating_windows.push_back(floating);
+    mark_dirty();
     return floating;
 }
 
@@ -437,6 +446,34 @@ void Workspace::trigger_rerender()
     });
 }
 
+bool Workspace::trigger_output_rerender()
+{
+    auto const touch = [](std::shared_ptr<Container> const& container)
+    {
+        auto window = container->window();
+        if (!window)
+            return false;
+
+        auto surface = window->operator std::shared_ptr<mir::scene::Surface>();
+        if (!surface)
+            return false;
+
+        surface->set_transformation(container->get_transform());
+        return true;
+    };
+
+    for (auto const& floating : floating_windows)
+    {
+        if (touch(floating))
+            return true;
+    }
+
+    return tree->find_node([&](std::shared_ptr<Container> const& node)
+    {
+        return node->is_leaf() && touch(node);
+    }) != nullptr;
+}
+
 bool Workspace::is_empty() const
 {
     return tree->is_empty() && floating_windows.empty();
@@ -463,6 +500,13 @@ void Workspace::graft(std::shared_ptr<Container> const& container)
             mir::log_error("Workspace::graft: ungraftable container type: %d", (int)container->get_type());
             break;
     }
+
+    mark_dirty();
+}
+
+void Workspace::mark_dirty()
+{
+    generation = TreeGeneration::next();
 }
 
 int Workspace::workspace_to_number(int workspace)
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "animator.h"
 #include "container.h"
 #include "direction.h"
+#include "tree_generation.h"
 
 #include <glm/glm.hpp>
 #include <memory>
@@ -71,9 +72,20 @@ public:
     std::shared_ptr<FloatingContainer> add_floating_window(miral::Window const&);
     Output* get_output();
     void trigger_rerender();
+
+    /// Like [trigger_rerender], but touches a single window. That is enough to
+    /// get the output redrawn when only the output's transform has changed.
+    /// Returns false if the workspace has no window to touch.
+    bool trigger_output_rerender();
     [[nodiscard]] bool is_empty() const;
     void graft(std::shared_ptr<Container> const&);
     static int workspace_to_number(int workspace);
+    [[nodiscard]] std::shared_ptr<TilingWindowTree> const& get_tree() const { return tree; }
+    [[nodiscard]] std::vector<std::shared_ptr<FloatingContainer>> const& get_floating_windows() const { return floating_windows; }
+
+    /// Signals that state reported over IPC has changed within this workspace.
+    void mark_dirty();
+    [[nodiscard]] uint64_t get_generation() const { return generation; }
 
 private:
     Output* output;
@@ -85,6 +97,7 @@ private:
     CompositorState const& state;
     std::shared_ptr<MiracleConfig> config;
     std::shared_ptr<miral::MinimalWindowManager> floating_window_manager;
+    uint64_t generation = TreeGeneration::next();
 
     /// Retrieves the container that is currently being used for layout
     std::shared_ptr<ParentContainer> get_layout_container();
@@ -1,3 +1,4 @@
+#include "easing.h"
 #include "miracle_config.h"
 #include "yaml-cpp/yaml.h"
 #include <cstdlib>
@@ -467,3 +468,157 @@ TEST_F(FilesystemConfigurationTest, BorderCanbeParsedObjectColor)
     EXPECT_EQ(config.get_border_config().color.b, 30.f / 255.f);
     EXPECT_EQ(config.get_border_config().color.a, 55.f / 255.f);
 }
+
+TEST_F(FilesystemConfigurationTest, IpcDefaultsToDisconnectingSlowClients)
+{
+    FilesystemConfiguration config(runner, path);
+    EXPECT_EQ(config.get_ipc_config().max_pending_bytes, 4u * 1024 * 1024);
+    EXPECT_EQ(config.get_ipc_config().slow_client_policy, IpcSlowClientPolicy::disconnect);
+}
+
+TEST_F(FilesystemConfigurationTest, IpcSlowClientPolicyCanBeParsed)
+{
+    YAML::Node ipc;
+    ipc["max_pending_bytes"] = 1024;
+    ipc["slow_client_policy"] = "drop_events";
+
+    YAML::Node node;
+    node["ipc"] = ipc;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    EXPECT_EQ(config.get_ipc_config().max_pending_bytes, 1024u);
+    EXPECT_EQ(config.get_ipc_config().slow_client_policy, IpcSlowClientPolicy::drop_events);
+}
+
+TEST_F(FilesystemConfigurationTest, EasingTablesAreOffByDefault)
+{
+    FilesystemConfiguration config(runner, path);
+    for (auto const& definition : config.get_animation_definitions())
+    {
+        EXPECT_EQ(definition.easing_table, nullptr);
+    }
+}
+
+TEST_F(FilesystemConfigurationTest, EasingTablesAreBuiltForTranscendentalCurves)
+{
+    YAML::Node item;
+    item["event"] = "window_move";
+    item["type"] = "slide";
+    item["function"] = "ease_out_elastic";
+
+    YAML::Node node;
+    node["animations"].push_back(item);
+    node["easing_lookup_table_size"] = 128;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    auto const& definitions = config.get_animation_definitions();
+    auto const& move = definitions[(int)AnimateableEvent::window_move];
+    ASSERT_NE(move.easing_table, nullptr);
+    EXPECT_EQ(move.easing_table->size(), 128u);
+
+    // The default window_open curve is a polynomial, which is evaluated exactly instead
+    EXPECT_EQ(definitions[(int)AnimateableEvent::window_open].easing_table, nullptr);
+}
+
+TEST_F(FilesystemConfigurationTest, InvalidEasingTableSizeIsIgnored)
+{
+    YAML::Node node;
+    node["easing_lookup_table_size"] = 1;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    for (auto const& definition : config.get_animation_definitions())
+    {
+        EXPECT_EQ(definition.easing_table, nullptr);
+    }
+}
+
+TEST_F(FilesystemConfigurationTest, CubicBezierAnimationCanBeParsed)
+{
+    YAML::Node item;
+    item["event"] = "window_move";
+    item["type"] = "slide";
+    item["function"] = "cubic_bezier";
+    item["bezier"].push_back(0.25);
+    item["bezier"].push_back(0.1);
+    item["bezier"].push_back(0.25);
+    item["bezier"].push_back(1.0);
+
+    YAML::Node node;
+    node["animations"].push_back(item);
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    auto const& move = config.get_animation_definitions()[(int)AnimateableEvent::window_move];
+    EXPECT_EQ(move.function, EaseFunction::cubic_bezier);
+    ASSERT_NE(move.cubic_bezier, nullptr);
+    EXPECT_NEAR(move.cubic_bezier->solve(0.5f), 0.8024034f, 1e-4f);
+}
+
+TEST_F(FilesystemConfigurationTest, CubicBezierWithInvalidControlPointsIsIgnored)
+{
+    YAML::Node item;
+    item["event"] = "window_move";
+    item["type"] = "slide";
+    item["function"] = "cubic_bezier";
+    item["bezier"].push_back(1.5);
+    item["bezier"].push_back(0.1);
+    item["bezier"].push_back(0.25);
+    item["bezier"].push_back(1.0);
+
+    YAML::Node node;
+    node["animations"].push_back(item);
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    auto const& move = config.get_animation_definitions()[(int)AnimateableEvent::window_move];
+    EXPECT_NE(move.function, EaseFunction::cubic_bezier);
+}
+
+TEST_F(FilesystemConfigurationTest, SpringAnimationCanBeParsed)
+{
+    YAML::Node item;
+    item["event"] = "window_move";
+    item["type"] = "slide";
+    item["function"] = "spring";
+
+    YAML::Node node;
+    node["animations"].push_back(item);
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    EXPECT_EQ(config.get_animation_definitions()[(int)AnimateableEvent::window_move].function, EaseFunction::spring);
+}
+
+TEST_F(FilesystemConfigurationTest, FadeCloseAnimationCanBeParsed)
+{
+    YAML::Node item;
+    item["event"] = "window_close";
+    item["type"] = "fade";
+    item["function"] = "linear";
+
+    YAML::Node node;
+    node["animations"].push_back(item);
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    EXPECT_EQ(config.get_animation_definitions()[(int)AnimateableEvent::window_close].type, AnimationType::fade);
+}
+
+TEST_F(FilesystemConfigurationTest, CloseAnimationMemoryLimitDefaultsTo64MiB)
+{
+    FilesystemConfiguration config(runner, path);
+    EXPECT_EQ(config.get_close_animation_memory_limit(), 64u * 1024 * 1024);
+}
+
+TEST_F(FilesystemConfigurationTest, CloseAnimationMemoryLimitCanBeParsed)
+{
+    YAML::Node node;
+    node["close_animation_memory_limit_mb"] = 16;
+    write_yaml_node(node);
+
+    FilesystemConfiguration config(runner, path);
+    EXPECT_EQ(config.get_close_animation_memory_limit(), 16u * 1024 * 1024);
+}
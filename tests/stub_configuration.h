@@ -93,11 +93,21 @@ namespace test
             return false;
         }
 
+        [[nodiscard]] size_t get_close_animation_memory_limit() const override
+        {
+            return 0;
+        }
+
         [[nodiscard]] WorkspaceConfig get_workspace_config(int key) const override
         {
             return WorkspaceConfig(key);
         }
 
+        [[nodiscard]] IpcConfig const& get_ipc_config() const override
+        {
+            return ipc_config;
+        }
+
         int register_listener(std::function<void(miracle::MiracleConfig&)> const&) override
         {
             return -1;
@@ -119,6 +129,7 @@ namespace test
     private:
         miracle::BorderConfig border_config;
         std::array<AnimationDefinition, (int)AnimateableEvent::max> animations;
+        miracle::IpcConfig ipc_config;
     };
 }
 }
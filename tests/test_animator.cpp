@@ -17,12 +17,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "animator.h"
 #include "miracle_config.h"
+#include "stub_server_action_queue.h"
 #include "yaml-cpp/yaml.h"
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <mir/server_action_queue.h>
 #include <miral/runner.h>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 using namespace miracle;
 
@@ -33,34 +38,26 @@ char const* argv[] = { "miracle-wm-tests" };
 const std::string path = std::filesystem::current_path() / "test.yaml";
 }
 
-class ImmediateServerActionQueue : public mir::ServerActionQueue
-{
-    void enqueue(void const* owner, mir::ServerAction const& action) override
-    {
-        action();
-    }
-
-    void enqueue_with_guaranteed_execution(mir::ServerAction const& action) override
-    {
-        action();
-    }
-
-    void pause_processing_for(void const* owner) override { };
-    void resume_processing_for(void const* owner) override { };
-};
-
 class AnimatorTest : public testing::Test
 {
 public:
     AnimatorTest() :
         runner(argc, argv),
-        queue { std::make_shared<ImmediateServerActionQueue>() },
+        queue { std::make_shared<test::ImmediateServerActionQueue>() },
         config { std::make_shared<FilesystemConfiguration>(runner, path) }
     {
     }
+
+    /// A synthetic clock that only moves when the test advances it
+    Animator::Clock synthetic_clock()
+    {
+        return [this]() { return now; };
+    }
+
     miral::MirRunner runner;
     std::shared_ptr<mir::ServerActionQueue> queue;
     std::shared_ptr<MiracleConfig> config;
+    AnimationTimePoint now;
 };
 
 TEST_F(AnimatorTest, CanStepLinearSlideAnimation)
@@ -75,7 +72,7 @@ TEST_F(AnimatorTest, CanStepLinearSlideAnimation)
     std::fstream file(path, std::ios::app);
     file << node;
 
-    Animator animator(queue, config);
+    Animator animator(queue, config, synthetic_clock());
     auto handle = animator.register_animateable();
     bool was_called = false;
     animator.window_move(
@@ -93,7 +90,8 @@ TEST_F(AnimatorTest, CanStepLinearSlideAnimation)
     {
         was_called = true;
     });
-    animator.step();
+    now += std::chrono::milliseconds(16);
+    animator.step(now);
     EXPECT_EQ(was_called, true);
 }
 
@@ -109,9 +107,9 @@ TEST_F(AnimatorTest, LinearSlideResultsInCorrectNewPoint)
     std::fstream file(path, std::ios::app);
     file << node;
 
-    Animator animator(queue, config);
+    Animator animator(queue, config, synthetic_clock());
     auto handle = animator.register_animateable();
-    mir::geometry::Point point;
+    std::optional<float> x;
     animator.window_move(
         handle,
         mir::geometry::Rectangle(
@@ -126,16 +124,42 @@ TEST_F(AnimatorTest, LinearSlideResultsInCorrectNewPoint)
         [&](AnimationStepResult const& asr)
     {
         if (asr.position)
-            EXPECT_EQ(asr.position.value().x, 600 * Animator::timestep_seconds);
+            x = asr.position.value().x;
     });
-    animator.step();
+    if (!config->are_animations_enabled())
+        GTEST_SKIP() << "animations are disabled";
+
+    // The animator must land exactly where the configured curve puts the window at that time
+    Animation expected(
+        handle,
+        config->get_animation_definitions()[(int)AnimateableEvent::window_move],
+        mir::geometry::Rectangle(
+            mir::geometry::Point(0, 0),
+            mir::geometry::Size(0, 0)),
+        mir::geometry::Rectangle(
+            mir::geometry::Point(600, 0),
+            mir::geometry::Size(0, 0)),
+        mir::geometry::Rectangle(
+            mir::geometry::Point(0, 0),
+            mir::geometry::Size(0, 0)),
+        [](auto const&) { });
+    expected.start(now);
+
+    now += std::chrono::milliseconds(250);
+    animator.step(now);
+    auto expected_result = expected.step(now);
+    ASSERT_TRUE(x.has_value());
+    ASSERT_TRUE(expected_result.position.has_value());
+    EXPECT_NEAR(x.value(), expected_result.position->x, 0.01);
 }
 
 class AnimationTest : public testing::Test
 {
 };
 
-TEST_F(AnimationTest, InterruptingSlideResultsInModifiedAnimationDuration)
+/// A slide that starts partway to its target begins from where the window is,
+/// rather than being given a head start along a path from where it was.
+TEST_F(AnimationTest, InterruptedSlideStartsFromCurrentPosition)
 {
     AnimationHandle handle = 0;
     AnimationDefinition definition;
@@ -155,5 +179,495 @@ TEST_F(AnimationTest, InterruptingSlideResultsInModifiedAnimationDuration)
             mir::geometry::Point(200, 200),
             mir::geometry::Size(0, 0)),
         [](auto const& asr) { });
-    ASSERT_NEAR(animation.get_runtime_seconds(), 2, 0.05);
-}
\ No newline at end of file
+    ASSERT_NEAR(animation.get_runtime_seconds(), 0, 0.05);
+
+    AnimationTimePoint start;
+    animation.start(start);
+    auto result = animation.step(start);
+    ASSERT_TRUE(result.position.has_value());
+    EXPECT_NEAR(result.position->x, 200.f, 0.01f);
+    EXPECT_NEAR(result.position->y, 200.f, 0.01f);
+}
+
+namespace
+{
+Animation make_linear_slide(float duration_seconds, float distance, AnimationHandle handle = 0)
+{
+    AnimationDefinition definition;
+    definition.duration_seconds = duration_seconds;
+    definition.type = AnimationType::slide;
+    definition.function = EaseFunction::linear;
+    return Animation(
+        handle,
+        definition,
+        mir::geometry::Rectangle(
+            mir::geometry::Point(0, 0),
+            mir::geometry::Size(0, 0)),
+        mir::geometry::Rectangle(
+            mir::geometry::Point(distance, 0),
+            mir::geometry::Size(0, 0)),
+        mir::geometry::Rectangle(
+            mir::geometry::Point(0, 0),
+            mir::geometry::Size(0, 0)),
+        [](auto const&) { });
+}
+
+Animation make_slide(
+    EaseFunction function,
+    float duration_seconds,
+    mir::geometry::Point from,
+    mir::geometry::Point to,
+    AnimationHandle handle = 0)
+{
+    AnimationDefinition definition;
+    definition.duration_seconds = duration_seconds;
+    definition.type = AnimationType::slide;
+    definition.function = function;
+    mir::geometry::Size size(100, 100);
+    return Animation(
+        handle,
+        definition,
+        mir::geometry::Rectangle(from, size),
+        mir::geometry::Rectangle(to, size),
+        mir::geometry::Rectangle(from, size),
+        [](auto const&) { });
+}
+}
+
+/// Stepping at any refresh rate must trace the same trajectory, and finish at
+/// the same time, because each step is evaluated at an absolute time.
+TEST_F(AnimationTest, TrajectoryIsIndependentOfStepRate)
+{
+    const float duration = 0.5f;
+    const float distance = 600.f;
+    for (double hz : { 30.0, 60.0, 144.0, 240.0 })
+    {
+        auto animation = make_linear_slide(duration, distance);
+        AnimationTimePoint start;
+        animation.start(start);
+
+        auto const interval = std::chrono::duration_cast<AnimationClock::duration>(std::chrono::duration<double>(1.0 / hz));
+        auto now = start;
+        AnimationStepResult result;
+        int frames = 0;
+        do
+        {
+            now += interval;
+            result = animation.step(now);
+            frames++;
+
+            float elapsed = std::chrono::duration<float>(now - start).count();
+            ASSERT_TRUE(result.position.has_value());
+            if (!result.is_complete)
+            {
+                EXPECT_NEAR(result.position->x, distance * elapsed / duration, 0.1f) << "hz=" << hz;
+            }
+        } while (!result.is_complete);
+
+        EXPECT_EQ(result.position->x, distance) << "hz=" << hz;
+        EXPECT_NEAR(frames, std::ceil(duration * hz), 1) << "hz=" << hz;
+    }
+}
+
+/// A late step lands where the animation should be at that moment, instead of
+/// where it would have been one fixed timestep after the previous step.
+TEST_F(AnimationTest, LateStepsDoNotSlowTheAnimationDown)
+{
+    auto animation = make_linear_slide(1.f, 1000.f);
+    AnimationTimePoint start;
+    animation.start(start);
+
+    animation.step(start + std::chrono::milliseconds(16));
+    auto result = animation.step(start + std::chrono::milliseconds(400));
+    ASSERT_TRUE(result.position.has_value());
+    EXPECT_NEAR(result.position->x, 400.f, 0.1f);
+}
+
+TEST_F(AnimatorTest, FrameIntervalFollowsRefreshRate)
+{
+    Animator animator(queue, config, synthetic_clock());
+    EXPECT_EQ(animator.get_frame_interval(), std::chrono::nanoseconds(static_cast<int64_t>(1e9 / Animator::default_refresh_rate)));
+
+    animator.set_refresh_rate(144.0);
+    EXPECT_EQ(animator.get_frame_interval(), std::chrono::nanoseconds(6944444));
+
+    animator.set_refresh_rate(0);
+    EXPECT_EQ(animator.get_frame_interval(), std::chrono::nanoseconds(6944444));
+}
+
+namespace
+{
+class CountingServerActionQueue : public mir::ServerActionQueue
+{
+public:
+    void enqueue(void const* owner, mir::ServerAction const& action) override
+    {
+        enqueued++;
+        action();
+    }
+
+    void enqueue_with_guaranteed_execution(mir::ServerAction const& action) override
+    {
+        enqueued++;
+        action();
+    }
+
+    void pause_processing_for(void const* owner) override { };
+    void resume_processing_for(void const* owner) override { };
+
+    int enqueued = 0;
+};
+}
+
+/// A group of moves is queued at a single instant, even if the clock moves on
+/// while it is being queued, and each frame of the group reaches the server
+/// thread in a single action.
+TEST_F(AnimatorTest, WindowMoveGroupStartsTogether)
+{
+    if (!config->are_animations_enabled())
+        GTEST_SKIP() << "animations are disabled";
+
+    auto counting_queue = std::make_shared<CountingServerActionQueue>();
+    Animator animator(counting_queue, config, [this]()
+    {
+        auto result = now;
+        now += std::chrono::milliseconds(1);
+        return result;
+    });
+
+    const int num_windows = 10;
+    std::vector<std::optional<float>> x(num_windows + 1);
+    std::vector<WindowMove> moves;
+    for (int i = 0; i < num_windows; i++)
+    {
+        auto handle = animator.register_animateable();
+        moves.push_back({
+            handle,
+            mir::geometry::Rectangle(mir::geometry::Point(0, i * 100), mir::geometry::Size(100, 100)),
+            mir::geometry::Rectangle(mir::geometry::Point(600, i * 100), mir::geometry::Size(100, 100)),
+            mir::geometry::Rectangle(mir::geometry::Point(0, i * 100), mir::geometry::Size(100, 100)),
+            [&x, handle](AnimationStepResult const& asr)
+        {
+            if (asr.position)
+                x[handle] = asr.position->x;
+        }
+        });
+    }
+    animator.window_moves(moves);
+
+    AnimationTimePoint const frame = now + std::chrono::milliseconds(50);
+    animator.step(frame);
+    EXPECT_EQ(counting_queue->enqueued, 1);
+    for (int handle = 1; handle <= num_windows; handle++)
+    {
+        ASSERT_TRUE(x[handle].has_value());
+        EXPECT_EQ(x[handle].value(), x[1].value());
+    }
+}
+
+/// A callback that restarts its own animation when it completes, registering
+/// other animateables on the way, keeps receiving the new animation's updates.
+TEST_F(AnimatorTest, CompletionCallbackCanRestartItsAnimation)
+{
+    if (!config->are_animations_enabled())
+        GTEST_SKIP() << "animations are disabled";
+
+    Animator animator(queue, config, synthetic_clock());
+    auto const handle = animator.register_animateable();
+    auto const area = mir::geometry::Rectangle(mir::geometry::Point(0, 0), mir::geometry::Size(100, 100));
+    auto const moved = mir::geometry::Rectangle(mir::geometry::Point(600, 0), mir::geometry::Size(100, 100));
+
+    int restarted_calls = 0;
+    bool restarted = false;
+    animator.window_move(handle, area, moved, area, [&](AnimationStepResult const& asr)
+    {
+        if (!asr.is_complete || restarted)
+            return;
+
+        restarted = true;
+        for (int i = 0; i < 100; i++)
+            animator.register_animateable();
+        animator.window_move(handle, moved, area, moved, [&](AnimationStepResult const&)
+        {
+            restarted_calls++;
+        });
+    });
+
+    now += std::chrono::seconds(10);
+    animator.step(now);
+    ASSERT_TRUE(restarted);
+
+    restarted_calls = 0;
+    now += std::chrono::milliseconds(16);
+    animator.step(now);
+    EXPECT_EQ(restarted_calls, 1);
+}
+
+TEST(AnimationSlotMapTest, ReplacingAnAnimationKeepsOneEntryPerHandle)
+{
+    AnimationSlotMap map;
+    map.insert_or_replace(make_linear_slide(1.f, 100.f, 1), 1);
+    map.insert_or_replace(make_linear_slide(1.f, 100.f, 2), 1);
+    map.insert_or_replace(make_linear_slide(1.f, 100.f, 1), 2);
+
+    ASSERT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.handle_at(0), 1u);
+    EXPECT_EQ(map.generation_at(0), 2u);
+    EXPECT_EQ(map.handle_at(1), 2u);
+    EXPECT_EQ(map.generation_at(1), 1u);
+}
+
+TEST(AnimationSlotMapTest, RemovingMovesTheLastAnimationIntoPlace)
+{
+    AnimationSlotMap map;
+    for (AnimationHandle handle = 1; handle <= 3; handle++)
+        map.insert_or_replace(make_linear_slide(1.f, 100.f, handle), handle);
+
+    map.remove_at(0);
+    ASSERT_EQ(map.size(), 2u);
+    EXPECT_FALSE(map.contains(1));
+    EXPECT_EQ(map.handle_at(0), 3u);
+    EXPECT_EQ(map.animation_at(0).get_handle(), 3u);
+    EXPECT_EQ(map.handle_at(1), 2u);
+
+    // The moved animation can still be replaced in place
+    map.insert_or_replace(make_linear_slide(1.f, 100.f, 3), 7);
+    ASSERT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.generation_at(0), 7u);
+}
+
+/// Re-targeting every running animation, as holding down a move key does,
+/// replaces each animation in its slot rather than growing the map.
+TEST(AnimationSlotMapTest, RetargetingReplacesInPlace)
+{
+    const int rounds = 100;
+    for (int num_windows : { 10, 100, 1000 })
+    {
+        AnimationSlotMap map;
+        for (int round = 0; round < rounds; round++)
+        {
+            for (int i = 0; i < num_windows; i++)
+            {
+                auto handle = static_cast<AnimationHandle>(i + 1);
+                map.insert_or_replace(make_linear_slide(1.f, 100.f, handle), round);
+            }
+        }
+
+        ASSERT_EQ(map.size(), static_cast<size_t>(num_windows));
+        for (int i = 0; i < num_windows; i++)
+        {
+            EXPECT_EQ(map.handle_at(i), static_cast<AnimationHandle>(i + 1));
+            EXPECT_EQ(map.generation_at(i), static_cast<uint32_t>(rounds - 1));
+        }
+    }
+}
+
+/// While animating, the thread sleeps between frames rather than spinning,
+/// and once nothing is animating it stops stepping altogether.
+TEST_F(AnimatorTest, ThreadSleepsBetweenFramesAndWhenIdle)
+{
+    if (!config->are_animations_enabled())
+        GTEST_SKIP() << "animations are disabled";
+
+    // Records when the animator's own thread reads the clock, which it does
+    // once as it starts, once when it wakes from idle and once per frame
+    auto const test_thread = std::this_thread::get_id();
+    std::mutex readings_mutex;
+    std::vector<AnimationTimePoint> readings;
+    Animator animator(queue, config, [&]()
+    {
+        auto const reading = AnimationClock::now();
+        if (std::this_thread::get_id() != test_thread)
+        {
+            std::lock_guard lock(readings_mutex);
+            readings.push_back(reading);
+        }
+        return reading;
+    });
+    animator.start();
+
+    std::atomic<bool> complete = false;
+    auto const start = std::chrono::steady_clock::now();
+    animator.window_move(
+        animator.register_animateable(),
+        mir::geometry::Rectangle(
+            mir::geometry::Point(0, 0),
+            mir::geometry::Size(100, 100)),
+        mir::geometry::Rectangle(
+            mir::geometry::Point(600, 0),
+            mir::geometry::Size(100, 100)),
+        mir::geometry::Rectangle(
+            mir::geometry::Point(0, 0),
+            mir::geometry::Size(100, 100)),
+        [&](AnimationStepResult const& asr)
+    {
+        if (asr.is_complete)
+            complete = true;
+    });
+
+    while (!complete && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_TRUE(complete);
+
+    // Lets the thread finish the frame that completed the animation and go idle
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto const duration = config->get_animation_definitions()[(int)AnimateableEvent::window_move].duration_seconds;
+    auto const busy = animator.get_stats();
+    ASSERT_GE(busy.frames, 1u);
+    EXPECT_LE(busy.frames, static_cast<uint64_t>(duration * Animator::default_refresh_rate) + 2);
+
+    size_t busy_readings = 0;
+    {
+        // Each frame is due at least a frame interval after the one before, and
+        // the thread waits for it, so the frames are spread over that much time
+        std::lock_guard lock(readings_mutex);
+        busy_readings = readings.size();
+        ASSERT_GT(busy_readings, busy.frames);
+        EXPECT_LE(busy_readings, busy.frames + 2);
+
+        auto const first_frame = readings.end() - static_cast<std::ptrdiff_t>(busy.frames);
+        auto const scheduled_from = *(first_frame - 1);
+        EXPECT_GE(readings.back() - scheduled_from, animator.get_frame_interval() * static_cast<int64_t>(busy.frames - 1));
+    }
+
+    // Once idle, the thread neither steps nor even looks at the clock
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(animator.get_stats().frames, busy.frames);
+    {
+        std::lock_guard lock(readings_mutex);
+        EXPECT_EQ(readings.size(), busy_readings);
+    }
+    animator.stop();
+}
+
+/// Re-targeting a spring mid-flight starts the new slide where the old one
+/// was, moving at the same velocity, instead of restarting from rest.
+TEST_F(AnimationTest, RetargetedSpringKeepsPositionAndVelocity)
+{
+    AnimationTimePoint start;
+    auto first = make_slide(EaseFunction::spring, 0.5f, { 0, 0 }, { 600, 0 }, 1);
+    first.start(start);
+
+    auto const now = start + std::chrono::milliseconds(100);
+    auto const position = first.position_at(0.1f);
+    auto const velocity = first.velocity_at(0.1f);
+    ASSERT_GT(velocity.x, 0.f);
+
+    auto second = make_slide(
+        EaseFunction::spring,
+        0.5f,
+        { (int)position.x, (int)position.y },
+        { 600, 400 },
+        1);
+    second.continue_from(first, now);
+    second.start(now);
+
+    auto result = second.step(now);
+    ASSERT_TRUE(result.position.has_value());
+    EXPECT_NEAR(result.position->x, position.x, 0.01f);
+    EXPECT_NEAR(result.position->y, position.y, 0.01f);
+
+    auto continued_velocity = second.velocity_at(0.f);
+    EXPECT_NEAR(continued_velocity.x, velocity.x, std::abs(velocity.x) * 0.02f);
+    EXPECT_NEAR(continued_velocity.y, 0.f, 1.f);
+
+    // And it still settles on the new target
+    result = second.step(now + std::chrono::milliseconds(500));
+    EXPECT_TRUE(result.is_complete);
+    EXPECT_EQ(result.position->x, 600.f);
+    EXPECT_EQ(result.position->y, 400.f);
+}
+
+namespace
+{
+/// Asserts that [next], having just taken over from [previous] at [previous_runtime],
+/// starts at the same position and with the same velocity.
+void expect_c1_continuous(Animation const& previous, float previous_runtime, Animation const& next)
+{
+    auto const position = previous.position_at(previous_runtime);
+    auto const velocity = previous.velocity_at(previous_runtime);
+    auto const next_position = next.position_at(0.f);
+    auto const next_velocity = next.velocity_at(0.f);
+
+    EXPECT_NEAR(next_position.x, position.x, 0.05f);
+    EXPECT_NEAR(next_position.y, position.y, 0.05f);
+
+    // Velocities are in pixels per second and come from finite differences
+    auto const tolerance = std::max(glm::length(velocity) * 0.01f, 5.f);
+    EXPECT_NEAR(next_velocity.x, velocity.x, tolerance);
+    EXPECT_NEAR(next_velocity.y, velocity.y, tolerance);
+}
+}
+
+/// Re-targeting a slide keeps the window's position and velocity, whatever
+/// the curve, and it still lands on its new target.
+TEST_F(AnimationTest, RetargetingIsC1ContinuousForEveryCurve)
+{
+    const float duration = 0.3f;
+    for (int f = 0; f < (int)EaseFunction::max; f++)
+    {
+        auto function = static_cast<EaseFunction>(f);
+        SCOPED_TRACE("function=" + std::to_string(f));
+
+        AnimationTimePoint start;
+        auto first = make_slide(function, duration, { 0, 0 }, { 600, 0 }, 1);
+        first.start(start);
+
+        auto const now = start + std::chrono::milliseconds(100);
+        auto second = make_slide(function, duration, { 0, 0 }, { 200, 500 }, 1);
+        second.continue_from(first, now);
+        second.start(now);
+        expect_c1_continuous(first, 0.1f, second);
+
+        auto result = second.step(now + std::chrono::milliseconds(300));
+        EXPECT_TRUE(result.is_complete);
+        EXPECT_EQ(result.position->x, 200.f);
+        EXPECT_EQ(result.position->y, 500.f);
+    }
+}
+
+/// Opening several windows at once relayouts a tiled window several times in
+/// quick succession. Each relayout must blend into the next without a snap.
+TEST_F(AnimationTest, RapidRetargetsStayC1Continuous)
+{
+    const mir::geometry::Point targets[] = {
+        { 960, 0 },
+        { 640, 0 },
+        { 480, 0 },
+        { 384, 0 },
+        { 320, 0 }
+    };
+
+    AnimationTimePoint now;
+    auto current = make_slide(EaseFunction::ease_in_out_back, 0.25f, { 0, 0 }, { 1920, 0 }, 1);
+    current.start(now);
+    for (auto const& target : targets)
+    {
+        now += std::chrono::milliseconds(30);
+        auto next = make_slide(EaseFunction::ease_in_out_back, 0.25f, { 0, 0 }, target, 1);
+        next.continue_from(current, now);
+        next.start(now);
+        expect_c1_continuous(current, 0.03f, next);
+        current = next;
+    }
+}
+
+TEST_F(AnimationTest, FadeRunsFromOpaqueToTransparent)
+{
+    AnimationDefinition definition;
+    definition.duration_seconds = 1;
+    definition.type = AnimationType::fade;
+    definition.function = EaseFunction::linear;
+    Animation animation(1, definition, std::nullopt, std::nullopt, std::nullopt, [](auto const& asr) { });
+    EXPECT_EQ(animation.init().alpha, 1.f);
+
+    AnimationTimePoint start;
+    animation.start(start);
+    auto result = animation.step(start + std::chrono::milliseconds(250));
+    ASSERT_TRUE(result.alpha.has_value());
+    EXPECT_NEAR(result.alpha.value(), 0.75f, 1e-4f);
+    EXPECT_FALSE(result.is_complete);
+
+    EXPECT_TRUE(animation.step(start + std::chrono::seconds(1)).is_complete);
+}
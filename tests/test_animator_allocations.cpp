@@ -0,0 +1,135 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "animator.h"
+#include "miracle_config.h"
+#include "stub_server_action_queue.h"
+#include <cstdlib>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <miral/runner.h>
+#include <new>
+
+using namespace miracle;
+
+// This file is built into its own executable, because replacing the global
+// allocation functions would otherwise affect every other test.
+
+namespace
+{
+/// Allocations are only counted on the thread that asks for them, so that
+/// Mir's own threads cannot disturb the count.
+thread_local bool count_allocations = false;
+thread_local size_t allocation_count = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    if (count_allocations)
+        allocation_count++;
+
+    if (auto* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+int argc = 1;
+char const* argv[] = { "miracle-wm-allocation-tests" };
+const std::string path = std::filesystem::current_path() / "test.yaml";
+}
+
+class AnimatorAllocationTest : public testing::Test
+{
+public:
+    AnimatorAllocationTest() :
+        runner(argc, argv),
+        queue { std::make_shared<test::ImmediateServerActionQueue>() },
+        config { std::make_shared<FilesystemConfiguration>(runner, path) }
+    {
+    }
+
+    /// A synthetic clock that only moves when the test advances it
+    Animator::Clock synthetic_clock()
+    {
+        return [this]() { return now; };
+    }
+
+    miral::MirRunner runner;
+    std::shared_ptr<mir::ServerActionQueue> queue;
+    std::shared_ptr<MiracleConfig> config;
+    AnimationTimePoint now;
+};
+
+/// Once the result buffers have grown to fit the running animations, stepping
+/// them must not touch the heap, however many windows are animating.
+TEST_F(AnimatorAllocationTest, SteadyStateStepDoesNotAllocate)
+{
+    if (!config->are_animations_enabled())
+        GTEST_SKIP() << "animations are disabled";
+
+    Animator animator(queue, config, synthetic_clock());
+    const int num_windows = 30;
+    int calls = 0;
+    for (int i = 0; i < num_windows; i++)
+    {
+        animator.window_move(
+            animator.register_animateable(),
+            mir::geometry::Rectangle(
+                mir::geometry::Point(0, 0),
+                mir::geometry::Size(100, 100)),
+            mir::geometry::Rectangle(
+                mir::geometry::Point(600, i * 10),
+                mir::geometry::Size(100, 100)),
+            mir::geometry::Rectangle(
+                mir::geometry::Point(0, 0),
+                mir::geometry::Size(100, 100)),
+            [&](AnimationStepResult const&) { calls++; });
+    }
+
+    // Warm up, letting the result buffers grow to their steady-state capacity
+    for (int i = 0; i < 2; i++)
+    {
+        now += std::chrono::milliseconds(1);
+        animator.step(now);
+    }
+
+    calls = 0;
+    const int num_steps = 10;
+    count_allocations = true;
+    allocation_count = 0;
+    for (int i = 0; i < num_steps; i++)
+    {
+        now += std::chrono::milliseconds(1);
+        animator.step(now);
+    }
+    count_allocations = false;
+
+    EXPECT_EQ(calls, num_windows * num_steps);
+    EXPECT_EQ(allocation_count, 0u);
+}
@@ -0,0 +1,104 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "border_batch.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+geom::Rectangle rect(int x, int y, int width, int height)
+{
+    return { geom::Point { x, y }, geom::Size { width, height } };
+}
+
+/// The area covered by the triangles of [batch]
+float area_of(BorderBatch const& batch)
+{
+    float area = 0;
+    auto const& vertices = batch.get_vertices();
+    for (size_t i = 0; i + 2 < vertices.size(); i += 3)
+    {
+        auto const a = glm::vec2(vertices[i].position);
+        auto const b = glm::vec2(vertices[i + 1].position);
+        auto const c = glm::vec2(vertices[i + 2].position);
+        area += std::abs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) / 2.f;
+    }
+    return area;
+}
+}
+
+TEST(BorderBatchTest, BorderIsEightTrianglesCoveringTheFrame)
+{
+    BorderBatch batch;
+    batch.add(glm::mat4(1.f), rect(0, 0, 100, 50), 5, glm::vec4(1, 0, 0, 1));
+
+    EXPECT_EQ(batch.get_vertices().size(), 24u);
+    EXPECT_FLOAT_EQ(area_of(batch), 100 * 50 - 90 * 40);
+}
+
+TEST(BorderBatchTest, ColorIsPremultiplied)
+{
+    BorderBatch batch;
+    batch.add(glm::mat4(1.f), rect(0, 0, 10, 10), 1, glm::vec4(1, 0.5, 0, 0.5));
+
+    for (auto const& vertex : batch.get_vertices())
+    {
+        EXPECT_EQ(vertex.color, glm::vec4(0.5, 0.25, 0, 0.5));
+    }
+}
+
+TEST(BorderBatchTest, TransformMovesTheBorder)
+{
+    BorderBatch batch;
+    batch.add(glm::translate(glm::mat4(1.f), glm::vec3(1000, 0, 0)), rect(0, 0, 100, 100), 2, glm::vec4(1));
+
+    EXPECT_FALSE(batch.overlaps(rect(0, 0, 100, 100)));
+    EXPECT_TRUE(batch.overlaps(rect(1050, 50, 10, 10)));
+}
+
+TEST(BorderBatchTest, BordersOfAdjacentTilesDoNotOverlapTheirNeighbours)
+{
+    BorderBatch batch;
+    batch.add(glm::mat4(1.f), rect(0, 0, 100, 100), 2, glm::vec4(1));
+
+    EXPECT_FALSE(batch.overlaps(rect(110, 0, 100, 100)));
+    EXPECT_TRUE(batch.overlaps(rect(99, 0, 100, 100)));
+}
+
+TEST(BorderBatchTest, ManyBordersShareOneList)
+{
+    BorderBatch batch;
+    for (int i = 0; i < 100; i++)
+        batch.add(glm::mat4(1.f), rect(i * 110, 0, 100, 100), 2, glm::vec4(1));
+
+    EXPECT_EQ(batch.get_vertices().size(), 100u * 24u);
+    EXPECT_FLOAT_EQ(area_of(batch), 100.f * (100 * 100 - 96 * 96));
+}
+
+TEST(BorderBatchTest, ClearEmptiesTheBatch)
+{
+    BorderBatch batch;
+    batch.add(glm::mat4(1.f), rect(0, 0, 100, 100), 2, glm::vec4(1));
+    batch.clear();
+
+    EXPECT_TRUE(batch.empty());
+    EXPECT_FALSE(batch.overlaps(rect(0, 0, 100, 100)));
+}
@@ -0,0 +1,148 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "damage_tracker.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+char const window_a = 0;
+char const window_b = 0;
+
+DamageTracker::Element element(void const* id, geom::Rectangle const& bounds, uint64_t content = 1)
+{
+    return { id, content, bounds };
+}
+
+geom::Rectangle rect(int x, int y, int width, int height)
+{
+    return { geom::Point { x, y }, geom::Size { width, height } };
+}
+
+/// Records a frame holding [elements] and returns its damage for [buffer_age]
+std::optional<geom::Rectangle> frame(
+    DamageTracker& tracker, std::vector<DamageTracker::Element> const& elements, int buffer_age = 1)
+{
+    tracker.begin_frame();
+    for (auto const& e : elements)
+        tracker.add(e);
+    return tracker.end_frame(buffer_age);
+}
+}
+
+TEST(DamageTrackerTest, FirstFrameIsRedrawnInFull)
+{
+    DamageTracker tracker;
+    EXPECT_EQ(frame(tracker, { element(&window_a, rect(0, 0, 100, 100)) }), std::nullopt);
+}
+
+TEST(DamageTrackerTest, UnchangedFrameHasNoDamage)
+{
+    DamageTracker tracker;
+    frame(tracker, { element(&window_a, rect(0, 0, 100, 100)) });
+
+    auto damage = frame(tracker, { element(&window_a, rect(0, 0, 100, 100)) });
+    ASSERT_TRUE(damage.has_value());
+    EXPECT_EQ(damage->size.width.as_int() * damage->size.height.as_int(), 0);
+}
+
+TEST(DamageTrackerTest, MovedElementDamagesWhereItWasAndWhereItIs)
+{
+    DamageTracker tracker;
+    frame(tracker, { element(&window_a, rect(0, 0, 100, 100)), element(&window_b, rect(500, 500, 10, 10)) });
+
+    auto damage = frame(tracker, { element(&window_a, rect(50, 0, 100, 100)), element(&window_b, rect(500, 500, 10, 10)) });
+    EXPECT_EQ(damage, rect(0, 0, 150, 100));
+}
+
+TEST(DamageTrackerTest, NewContentDamagesTheElement)
+{
+    DamageTracker tracker;
+    frame(tracker, { element(&window_a, rect(0, 0, 100, 100)), element(&window_b, rect(500, 500, 10, 10), 1) });
+
+    auto damage = frame(tracker, { element(&window_a, rect(0, 0, 100, 100)), element(&window_b, rect(500, 500, 10, 10), 2) });
+    EXPECT_EQ(damage, rect(500, 500, 10, 10));
+}
+
+TEST(DamageTrackerTest, RemovedElementDamagesWhereItWas)
+{
+    DamageTracker tracker;
+    frame(tracker, { element(&window_a, rect(0, 0, 100, 100)), element(&window_b, rect(500, 500, 10, 10)) });
+
+    EXPECT_EQ(frame(tracker, { element(&window_a, rect(0, 0, 100, 100)) }), rect(500, 500, 10, 10));
+}
+
+TEST(DamageTrackerTest, OlderBuffersAccumulateDamage)
+{
+    DamageTracker tracker;
+    frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) });
+    frame(tracker, { element(&window_a, rect(10, 0, 10, 10)) });
+
+    // A buffer that was drawn two frames ago has missed both moves
+    EXPECT_EQ(frame(tracker, { element(&window_a, rect(20, 0, 10, 10)) }, 2), rect(0, 0, 30, 10));
+}
+
+TEST(DamageTrackerTest, UnknownOrTooOldBuffersAreRedrawnInFull)
+{
+    DamageTracker tracker;
+    frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) });
+
+    EXPECT_EQ(frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) }, 0), std::nullopt);
+    EXPECT_EQ(frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) }, DamageTracker::max_buffer_age + 1), std::nullopt);
+
+    // The full first frame is still within reach of a buffer this old
+    EXPECT_EQ(frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) }, 4), std::nullopt);
+    EXPECT_TRUE(frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) }, 4).has_value());
+}
+
+TEST(DamageTrackerTest, DamageAllRedrawsTheNextFrameInFull)
+{
+    DamageTracker tracker;
+    frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) });
+    tracker.damage_all();
+
+    EXPECT_EQ(frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) }), std::nullopt);
+    EXPECT_TRUE(frame(tracker, { element(&window_a, rect(0, 0, 10, 10)) }).has_value());
+}
+
+/// A 4K desktop of static windows, with a panel clock that ticks every frame
+TEST(DamageTrackerTest, MostlyStaticDesktopRedrawsAFractionOfTheOutput)
+{
+    const int output_pixels = 3840 * 2160;
+    const int num_windows = 20;
+    std::vector<int> ids(num_windows + 1);
+
+    DamageTracker tracker;
+    int64_t pixels_redrawn = 0;
+    const int num_frames = 60;
+    for (int i = 0; i < num_frames; i++)
+    {
+        std::vector<DamageTracker::Element> elements;
+        for (int w = 0; w < num_windows; w++)
+            elements.push_back(element(&ids[w], rect((w % 5) * 768, (w / 5) * 520 + 40, 768, 520)));
+        elements.push_back(element(&ids[num_windows], rect(3700, 8, 120, 24), i));
+
+        auto damage = frame(tracker, elements);
+        pixels_redrawn += damage ? damage->size.width.as_int() * damage->size.height.as_int() : output_pixels;
+    }
+
+    auto const full_redraw_pixels = static_cast<int64_t>(output_pixels) * num_frames;
+    EXPECT_LT(pixels_redrawn * 10, full_redraw_pixels);
+}
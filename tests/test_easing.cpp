@@ -0,0 +1,254 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "easing.h"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace miracle;
+
+TEST(EasingTest, BatchMatchesScalarForEveryFunction)
+{
+    // 101 values, so that both full lanes and the remainder are covered
+    std::vector<float> t(101);
+    for (size_t i = 0; i < t.size(); i++)
+        t[i] = static_cast<float>(i) / 100.f;
+
+    for (int f = 0; f < (int)EaseFunction::max; f++)
+    {
+        AnimationDefinition definition;
+        definition.function = static_cast<EaseFunction>(f);
+
+        std::vector<float> out(t.size());
+        ease_batch(definition, t.data(), out.data(), t.size());
+        for (size_t i = 0; i < t.size(); i++)
+        {
+            EXPECT_NEAR(out[i], ease(definition, t[i]), 1e-5f) << "function=" << f << " t=" << t[i];
+        }
+    }
+}
+
+TEST(EasingTest, SameCurveComparesFunctionAndCoefficients)
+{
+    AnimationDefinition a;
+    a.function = EaseFunction::ease_out_back;
+    auto b = a;
+    EXPECT_TRUE(same_curve(a, b));
+
+    b.c1 = 2.f;
+    EXPECT_FALSE(same_curve(a, b));
+
+    // Durations and types do not change the curve
+    b = a;
+    b.duration_seconds = 10.f;
+    b.type = AnimationType::grow;
+    EXPECT_TRUE(same_curve(a, b));
+}
+
+/// Evaluates 10, 100 and 1000 concurrent animations spread over a handful
+/// of curves, as they would be during a workspace switch, once per animation
+/// with [ease] and once per run of the same curve with [ease_batch].
+TEST(EasingTest, GroupedBatchesMatchScalarEvaluation)
+{
+    const EaseFunction functions[] = {
+        EaseFunction::ease_out_cubic,
+        EaseFunction::ease_in_out_quad,
+        EaseFunction::ease_out_back,
+        EaseFunction::ease_in_out_sine
+    };
+    const int num_functions = sizeof(functions) / sizeof(functions[0]);
+
+    for (int num_animations : { 10, 100, 1000 })
+    {
+        // Animations are laid out grouped by curve, as the animator orders them
+        std::vector<AnimationDefinition> definitions(num_animations);
+        std::vector<float> t(num_animations);
+        for (int i = 0; i < num_animations; i++)
+        {
+            definitions[i].function = functions[i * num_functions / num_animations];
+            t[i] = static_cast<float>(i) / static_cast<float>(num_animations);
+        }
+
+        std::vector<float> out(num_animations);
+        int num_batches = 0;
+        for (int begin = 0; begin < num_animations;)
+        {
+            auto end = begin + 1;
+            while (end < num_animations && same_curve(definitions[begin], definitions[end]))
+                end++;
+            ease_batch(definitions[begin], t.data() + begin, out.data() + begin, end - begin);
+            num_batches++;
+            begin = end;
+        }
+
+        EXPECT_EQ(num_batches, std::min(num_functions, num_animations));
+        for (int i = 0; i < num_animations; i++)
+        {
+            EXPECT_NEAR(out[i], ease(definitions[i], t[i]), 1e-5f) << "animations=" << num_animations << " i=" << i;
+        }
+    }
+}
+
+TEST(EasingTest, TableMatchesEndpointsExactly)
+{
+    AnimationDefinition definition;
+    definition.function = EaseFunction::ease_out_elastic;
+    EasingTable table(definition, 16);
+
+    EXPECT_EQ(table.sample(0.f), ease(definition, 0.f));
+    EXPECT_EQ(table.sample(1.f), ease(definition, 1.f));
+    EXPECT_EQ(table.sample(-1.f), ease(definition, 0.f));
+    EXPECT_EQ(table.sample(2.f), ease(definition, 1.f));
+}
+
+TEST(EasingTest, TableSizeIsClamped)
+{
+    AnimationDefinition definition;
+    EXPECT_EQ(EasingTable(definition, 0).size(), EasingTable::min_size);
+    EXPECT_EQ(EasingTable(definition, 1u << 20).size(), EasingTable::max_size);
+}
+
+/// Reports the worst error of the interpolated table against the analytic
+/// curve for every function, and checks that it shrinks as the table grows.
+TEST(EasingTest, TableAccuracyAgainstAnalytic)
+{
+    const int num_points = 10007;
+    for (int f = 0; f < (int)EaseFunction::max; f++)
+    {
+        AnimationDefinition analytic;
+        analytic.function = static_cast<EaseFunction>(f);
+
+        float previous_error = std::numeric_limits<float>::max();
+        for (size_t size : { 64, 256, 1024 })
+        {
+            auto tabled = analytic;
+            tabled.easing_table = std::make_shared<EasingTable const>(analytic, size);
+
+            float max_error = 0;
+            for (int i = 0; i <= num_points; i++)
+            {
+                float t = static_cast<float>(i) / num_points;
+                max_error = std::max(max_error, std::abs(ease(tabled, t) - ease(analytic, t)));
+            }
+
+            EXPECT_LE(max_error, previous_error + 1e-6f) << "function=" << f << " size=" << size;
+            // The circ curves have vertical tangents at their ends, which is where
+            // linear interpolation does worst
+            if (size == 1024)
+            {
+                EXPECT_LT(max_error, 2e-2f) << "function=" << f;
+            }
+            previous_error = max_error;
+        }
+    }
+}
+
+/// The batched path samples the table for every value in the run, so it
+/// must agree with evaluating the same table one value at a time.
+TEST(EasingTest, TabledBatchMatchesTabledScalar)
+{
+    const EaseFunction functions[] = {
+        EaseFunction::ease_in_out_back,
+        EaseFunction::ease_out_expo,
+        EaseFunction::ease_out_elastic,
+        EaseFunction::ease_in_out_bounce
+    };
+    const int num_values = 1000;
+
+    std::vector<float> t(num_values);
+    for (int i = 0; i < num_values; i++)
+        t[i] = static_cast<float>(i) / num_values;
+    std::vector<float> out(num_values);
+
+    for (auto function : functions)
+    {
+        AnimationDefinition analytic;
+        analytic.function = function;
+        auto tabled = analytic;
+        tabled.easing_table = std::make_shared<EasingTable const>(analytic, 256);
+
+        ease_batch(tabled, t.data(), out.data(), num_values);
+        for (int i = 0; i < num_values; i++)
+        {
+            EXPECT_EQ(out[i], tabled.easing_table->sample(t[i])) << "function=" << (int)function << " t=" << t[i];
+            EXPECT_NEAR(out[i], ease(analytic, t[i]), 2e-2f) << "function=" << (int)function << " t=" << t[i];
+        }
+    }
+}
+
+TEST(EasingTest, CubicBezierMatchesCssEase)
+{
+    // The CSS 'ease' timing function
+    CubicBezier bezier(0.25f, 0.1f, 0.25f, 1.f);
+    EXPECT_NEAR(bezier.solve(0.5f), 0.8024034f, 1e-4f);
+    EXPECT_EQ(bezier.solve(0.f), 0.f);
+    EXPECT_EQ(bezier.solve(1.f), 1.f);
+
+    CubicBezier linear(0.3f, 0.3f, 0.7f, 0.7f);
+    EXPECT_FLOAT_EQ(linear.solve(0.42f), 0.42f);
+}
+
+TEST(EasingTest, CubicBezierIsMonotonicForMonotonicControlPoints)
+{
+    // Includes curves that are flat at their ends, where Newton's method gives up
+    CubicBezier const curves[] = {
+        { 0.42f, 0.f, 0.58f, 1.f },
+        { 1.f, 0.f, 1.f, 0.f },
+        { 0.f, 0.f, 0.f, 1.f }
+    };
+    for (auto const& curve : curves)
+    {
+        float previous = 0.f;
+        for (int i = 0; i <= 1000; i++)
+        {
+            float y = curve.solve(static_cast<float>(i) / 1000.f);
+            EXPECT_GE(y, previous - 1e-5f);
+            previous = y;
+        }
+        EXPECT_EQ(previous, 1.f);
+    }
+}
+
+TEST(EasingTest, CubicBezierDefinitionWithoutControlPointsIsLinear)
+{
+    AnimationDefinition definition;
+    definition.function = EaseFunction::cubic_bezier;
+    EXPECT_EQ(ease(definition, 0.3f), 0.3f);
+
+    definition.cubic_bezier = std::make_shared<CubicBezier const>(0.25f, 0.1f, 0.25f, 1.f);
+    EXPECT_NEAR(ease(definition, 0.5f), 0.8024034f, 1e-4f);
+}
+
+TEST(EasingTest, SpringSettlesAtTheEndOfItsDuration)
+{
+    AnimationDefinition definition;
+    definition.function = EaseFunction::spring;
+    EXPECT_EQ(ease(definition, 0.f), 0.f);
+    EXPECT_NEAR(ease(definition, 1.f), 1.f, 1.1e-3f);
+
+    float previous = 0.f;
+    for (int i = 1; i <= 100; i++)
+    {
+        float value = ease(definition, static_cast<float>(i) / 100.f);
+        EXPECT_GT(value, previous);
+        previous = value;
+    }
+}
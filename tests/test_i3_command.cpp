@@ -16,6 +16,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **/
 
 #include "i3_command.h"
+#include "regex_cache.h"
 #include <gtest/gtest.h>
 
 using namespace miracle;
@@ -103,4 +104,78 @@ TEST_F(I3CommandTest, CanParseSplitCommand)
     ASSERT_EQ(commands[0].commands.size(), 1);
     ASSERT_EQ(commands[0].commands[0].type, I3CommandType::split);
     ASSERT_EQ(commands[0].commands[0].arguments[0], "vertical");
-}
\ No newline at end of file
+}
+
+TEST_F(I3CommandTest, RegexIsCompiledWhenScopeIsParsed)
+{
+    std::string v = "[title=\"^Firefox.*\"]";
+    int ptr;
+    auto scope = I3Scope::parse(v, ptr);
+    ASSERT_NE(scope[0].compiled_regex, nullptr);
+    EXPECT_TRUE(scope[0].compiled_regex->is_valid());
+    EXPECT_TRUE(scope[0].compiled_regex->matches("Firefox - Private Browsing"));
+    EXPECT_FALSE(scope[0].compiled_regex->matches("Chromium"));
+}
+
+TEST_F(I3CommandTest, RepeatedCriteriaShareTheCompiledRegex)
+{
+    std::string v = "[title=\"shared-pattern\"]";
+    int ptr;
+    auto first = I3Scope::parse(v, ptr);
+    auto second = I3Scope::parse(v, ptr);
+    EXPECT_EQ(first[0].compiled_regex, second[0].compiled_regex);
+}
+
+TEST_F(I3CommandTest, RegexCacheEvictsLeastRecentlyUsed)
+{
+    RegexCache cache(2);
+    auto a = cache.get("a");
+    auto b = cache.get("b");
+    EXPECT_EQ(cache.get("a"), a);
+
+    // "b" is now the least recently used
+    cache.get("c");
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.get("a"), a);
+    EXPECT_NE(cache.get("b"), b);
+}
+
+TEST_F(I3CommandTest, RegexCacheRemembersInvalidPatterns)
+{
+    RegexCache cache(2);
+    auto invalid = cache.get("(unclosed");
+    EXPECT_FALSE(invalid->is_valid());
+    EXPECT_FALSE(invalid->matches("(unclosed"));
+    EXPECT_EQ(cache.get("(unclosed"), invalid);
+}
+
+TEST_F(I3CommandTest, CanParseUnquotedConId)
+{
+    std::string v = "[con_id=1234 floating]";
+    int ptr;
+    auto scope = I3Scope::parse(v, ptr);
+    ASSERT_EQ(scope.size(), 2);
+    ASSERT_EQ(scope[0].type, I3ScopeType::con_id);
+    ASSERT_EQ(scope[0].regex.value(), "1234");
+    ASSERT_EQ(scope[1].type, I3ScopeType::floating);
+}
+
+TEST_F(I3CommandTest, CanParseAppIdAndWorkspace)
+{
+    std::string v = "[app_id=\"^foot$\" workspace=\"3\"]";
+    int ptr;
+    auto scope = I3Scope::parse(v, ptr);
+    ASSERT_EQ(scope.size(), 2);
+    ASSERT_EQ(scope[0].type, I3ScopeType::app_id);
+    ASSERT_EQ(scope[0].regex.value(), "^foot$");
+    ASSERT_EQ(scope[1].type, I3ScopeType::workspace);
+    ASSERT_EQ(scope[1].regex.value(), "3");
+}
+
+TEST_F(I3CommandTest, AnchoredLiteralRegexHasExactMatch)
+{
+    RegexCache cache(4);
+    EXPECT_EQ(cache.get("^Mozilla Firefox$")->get_exact_match(), "Mozilla Firefox");
+    EXPECT_FALSE(cache.get("Mozilla Firefox")->get_exact_match());
+    EXPECT_FALSE(cache.get("^Mozilla.*$")->get_exact_match());
+}
@@ -0,0 +1,201 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "i3_command_dispatcher.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <gtest/gtest.h>
+#include <mir/server_action_queue.h>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+using namespace miracle;
+
+namespace
+{
+/// Runs actions in order on a thread of its own, like the server's main loop.
+class ThreadedServerActionQueue : public mir::ServerActionQueue
+{
+public:
+    ThreadedServerActionQueue() :
+        thread([this]() { run(); })
+    {
+    }
+
+    ~ThreadedServerActionQueue() override
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+    void enqueue(void const*, mir::ServerAction const& action) override
+    {
+        {
+            std::lock_guard lock(mutex);
+            actions.push_back(action);
+        }
+        cv.notify_one();
+    }
+
+    void enqueue_with_guaranteed_execution(mir::ServerAction const& action) override
+    {
+        enqueue(nullptr, action);
+    }
+
+    void pause_processing_for(void const*) override { }
+    void resume_processing_for(void const*) override { }
+
+private:
+    void run()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            cv.wait(lock, [this]() { return stopping || !actions.empty(); });
+            if (actions.empty())
+                return;
+
+            auto action = std::move(actions.front());
+            actions.pop_front();
+            lock.unlock();
+            action();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<mir::ServerAction> actions;
+    bool stopping = false;
+    std::thread thread;
+};
+}
+
+TEST(I3CommandDispatcherTest, RepliesWithOneResultPerCommand)
+{
+    auto queue = std::make_shared<ThreadedServerActionQueue>();
+    I3CommandDispatcher dispatcher(queue, [](std::vector<I3ScopedCommandList> const& command_lists)
+    {
+        std::vector<I3CommandResult> results;
+        for (auto const& command_list : command_lists)
+        {
+            for (auto const& command : command_list.commands)
+            {
+                if (command.type == I3CommandType::exec)
+                    results.push_back({});
+                else
+                    results.push_back({ false, "unsupported" });
+            }
+        }
+        return results;
+    });
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<std::vector<I3CommandResult>> received;
+    std::string command = "exec foot, nop";
+    dispatcher.dispatch(command, [&](std::vector<I3CommandResult> const& results)
+    {
+        std::lock_guard lock(mutex);
+        received = results;
+        cv.notify_one();
+    });
+
+    std::unique_lock lock(mutex);
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&]() { return received.has_value(); }));
+    ASSERT_EQ(received->size(), 2u);
+    EXPECT_TRUE((*received)[0].success);
+    EXPECT_FALSE((*received)[1].success);
+    EXPECT_EQ((*received)[1].error, "unsupported");
+}
+
+/// Several clients send commands as fast as they can while earlier ones are still
+/// waiting to run. Every command must run exactly once, each client's commands must
+/// run in the order that they were sent, and every message must get its own reply.
+TEST(I3CommandDispatcherTest, NoCommandsAreLostUnderConcurrentLoad)
+{
+    const int num_clients = 8;
+    const int commands_per_client = 2000;
+
+    std::vector<std::vector<int>> executed(num_clients);
+    std::atomic<int> num_replies = 0;
+    std::atomic<int> num_bad_replies = 0;
+
+    {
+        auto queue = std::make_shared<ThreadedServerActionQueue>();
+        I3CommandDispatcher dispatcher(queue, [&](std::vector<I3ScopedCommandList> const& command_lists)
+        {
+            // Only ever called from the queue's thread, so no locking is needed
+            std::vector<I3CommandResult> results;
+            for (auto const& command_list : command_lists)
+            {
+                for (auto const& command : command_list.commands)
+                {
+                    int client = std::stoi(command.arguments.at(0));
+                    int sequence = std::stoi(command.arguments.at(1));
+                    executed[client].push_back(sequence);
+                    results.push_back({});
+                }
+            }
+            return results;
+        });
+
+        std::vector<std::thread> clients;
+        for (int client = 0; client < num_clients; client++)
+        {
+            clients.emplace_back([&, client]()
+            {
+                for (int i = 0; i < commands_per_client; i++)
+                {
+                    auto command = "exec " + std::to_string(client) + " " + std::to_string(i);
+                    dispatcher.dispatch(command, [&](std::vector<I3CommandResult> const& results)
+                    {
+                        if (results.size() != 1 || !results[0].success)
+                            num_bad_replies++;
+                        num_replies++;
+                    });
+                }
+            });
+        }
+
+        for (auto& client : clients)
+            client.join();
+
+        // The dispatcher must outlive the commands that are still queued
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (num_replies < num_clients * commands_per_client && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(num_replies, num_clients * commands_per_client);
+    EXPECT_EQ(num_bad_replies, 0);
+    for (int client = 0; client < num_clients; client++)
+    {
+        ASSERT_EQ(executed[client].size(), (size_t)commands_per_client);
+        for (int i = 0; i < commands_per_client; i++)
+        {
+            EXPECT_EQ(executed[client][i], i);
+        }
+    }
+}
@@ -0,0 +1,200 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "ipc_frame.h"
+#include <cstring>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace miracle;
+
+namespace
+{
+struct SocketPair
+{
+    SocketPair()
+    {
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    }
+
+    ~SocketPair()
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    /// Read everything that is currently available on the receiving end.
+    std::string drain() const
+    {
+        std::string result;
+        char buf[4096];
+        ssize_t count;
+        while ((count = read(fds[1], buf, sizeof(buf))) > 0)
+            result.append(buf, count);
+        return result;
+    }
+
+    int writer() const { return fds[0]; }
+
+    int fds[2];
+};
+
+std::string expected_bytes(IpcFrame const& frame)
+{
+    return std::string(frame.get_header().data(), frame.get_header().size()) + frame.get_payload();
+}
+}
+
+TEST(IpcFrameTest, HeaderContainsMagicLengthAndType)
+{
+    IpcFrame frame(IPC_EVENT_WORKSPACE, "{}");
+    auto const& header = frame.get_header();
+    uint32_t length;
+    uint32_t type;
+    memcpy(&length, header.data() + sizeof(ipc_magic), sizeof(length));
+    memcpy(&type, header.data() + sizeof(ipc_magic) + sizeof(length), sizeof(type));
+
+    EXPECT_EQ(memcmp(header.data(), ipc_magic, sizeof(ipc_magic)), 0);
+    EXPECT_EQ(length, 2u);
+    EXPECT_EQ(type, (uint32_t)IPC_EVENT_WORKSPACE);
+    EXPECT_EQ(frame.size(), IpcFrame::header_size + 2);
+}
+
+TEST(IpcFrameTest, FlushWritesQueuedFramesInOrder)
+{
+    SocketPair sockets;
+    IpcWriteQueue queue;
+    auto first = std::make_shared<IpcFrame const>(IPC_GET_TREE, "first");
+    auto second = std::make_shared<IpcFrame const>(IPC_EVENT_MODE, "second");
+    queue.push(first);
+    queue.push(second);
+    EXPECT_EQ(queue.pending_bytes(), first->size() + second->size());
+
+    EXPECT_EQ(queue.flush(sockets.writer()), IpcWriteQueue::FlushResult::done);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.pending_bytes(), 0u);
+    EXPECT_EQ(sockets.drain(), expected_bytes(*first) + expected_bytes(*second));
+}
+
+TEST(IpcFrameTest, PartialWritesResumeFromTheRightOffset)
+{
+    SocketPair sockets;
+    int size = 4096;
+    setsockopt(sockets.writer(), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    IpcWriteQueue queue;
+    std::string expected;
+    for (int i = 0; i < 16; i++)
+    {
+        auto frame = std::make_shared<IpcFrame const>(IPC_EVENT_WINDOW, std::string(10000, 'a' + i));
+        expected += expected_bytes(*frame);
+        queue.push(frame);
+    }
+
+    std::string received;
+    int iterations = 0;
+    while (queue.flush(sockets.writer()) == IpcWriteQueue::FlushResult::would_block)
+    {
+        ASSERT_LT(iterations++, 10000);
+        received += sockets.drain();
+    }
+    received += sockets.drain();
+
+    EXPECT_EQ(received, expected);
+}
+
+TEST(IpcFrameTest, FlushReportsErrorWhenPeerIsGone)
+{
+    SocketPair sockets;
+    close(sockets.fds[1]);
+    sockets.fds[1] = -1;
+
+    IpcWriteQueue queue;
+    queue.push(std::make_shared<IpcFrame const>(IPC_EVENT_MODE, "{}"));
+    EXPECT_EQ(queue.flush(sockets.writer()), IpcWriteQueue::FlushResult::error);
+}
+
+TEST(IpcFrameTest, DropEventsKeepsRepliesAndPartiallyWrittenFrames)
+{
+    SocketPair sockets;
+    int size = 4096;
+    setsockopt(sockets.writer(), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    IpcWriteQueue queue;
+    auto partial = std::make_shared<IpcFrame const>(IPC_EVENT_WORKSPACE, std::string(100000, 'p'));
+    auto reply = std::make_shared<IpcFrame const>(IPC_GET_TREE, "reply");
+    auto event = std::make_shared<IpcFrame const>(IPC_EVENT_MODE, "event");
+    queue.push(partial);
+    ASSERT_EQ(queue.flush(sockets.writer()), IpcWriteQueue::FlushResult::would_block);
+    queue.push(reply);
+    queue.push(event);
+
+    auto pending = queue.pending_bytes();
+    EXPECT_EQ(queue.drop_events(pending), event->size());
+    EXPECT_EQ(queue.pending_bytes(), pending - event->size());
+
+    std::string received;
+    while (queue.flush(sockets.writer()) == IpcWriteQueue::FlushResult::would_block)
+        received += sockets.drain();
+    received += sockets.drain();
+    EXPECT_EQ(received, expected_bytes(*partial) + expected_bytes(*reply));
+}
+
+TEST(IpcFrameTest, DropEventsRemovesOldestEventsFirst)
+{
+    IpcWriteQueue queue;
+    auto oldest = std::make_shared<IpcFrame const>(IPC_EVENT_WORKSPACE, "oldest");
+    auto newest = std::make_shared<IpcFrame const>(IPC_EVENT_WORKSPACE, "newest");
+    queue.push(oldest);
+    queue.push(newest);
+
+    EXPECT_EQ(queue.drop_events(1), oldest->size());
+    EXPECT_EQ(queue.pending_bytes(), newest->size());
+}
+
+/// Broadcasting an event builds a single frame that every subscriber shares, rather
+/// than a copy per subscriber. Only the kernel copies the bytes into each socket.
+TEST(IpcFrameTest, BroadcastSharesOneFrameAcrossSubscribers)
+{
+    const std::string payload(2048, 'x');
+    const int num_events = 20;
+    for (int num_subscribers : { 1, 10, 100 })
+    {
+        std::vector<std::unique_ptr<SocketPair>> sockets;
+        std::vector<IpcWriteQueue> queues(num_subscribers);
+        for (int i = 0; i < num_subscribers; i++)
+            sockets.push_back(std::make_unique<SocketPair>());
+
+        for (int event = 0; event < num_events; event++)
+        {
+            auto frame = std::make_shared<IpcFrame const>(IPC_EVENT_WORKSPACE, payload);
+            for (int i = 0; i < num_subscribers; i++)
+                queues[i].push(frame);
+
+            EXPECT_EQ(frame.use_count(), num_subscribers + 1);
+            for (int i = 0; i < num_subscribers; i++)
+            {
+                ASSERT_EQ(queues[i].flush(sockets[i]->writer()), IpcWriteQueue::FlushResult::done);
+                EXPECT_EQ(sockets[i]->drain(), expected_bytes(*frame));
+            }
+        }
+    }
+}
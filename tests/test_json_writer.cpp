@@ -0,0 +1,163 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "json_writer.h"
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+
+using namespace miracle;
+using json = nlohmann::json;
+
+TEST(JsonWriterTest, WritesNestedObjectsAndArrays)
+{
+    std::string out;
+    JsonWriter writer(out);
+    writer.begin_object()
+        .field("id", 1)
+        .key("nodes")
+        .begin_array()
+        .value(true)
+        .null()
+        .begin_object()
+        .end_object()
+        .end_array()
+        .field("name", "root")
+        .end_object();
+
+    EXPECT_EQ(out, R"({"id":1,"nodes":[true,null,{}],"name":"root"})");
+}
+
+TEST(JsonWriterTest, EscapesStrings)
+{
+    std::string out;
+    JsonWriter writer(out);
+    writer.value(std::string_view("a\"b\\c\nd\te\x01"));
+
+    EXPECT_EQ(out, R"("a\"b\\c\nd\te\u0001")");
+    EXPECT_EQ(json::parse(out).get<std::string>(), "a\"b\\c\nd\te\x01");
+}
+
+TEST(JsonWriterTest, WritesNumbers)
+{
+    std::string out;
+    JsonWriter writer(out);
+    writer.begin_array()
+        .value(-42)
+        .value(static_cast<uint64_t>(18446744073709551615ull))
+        .value(0.5)
+        .end_array();
+
+    EXPECT_EQ(out, "[-42,18446744073709551615,0.5]");
+}
+
+TEST(JsonWriterTest, RawValuesAreSeparated)
+{
+    std::string out;
+    JsonWriter writer(out);
+    writer.begin_array().raw("{\"a\":1}").raw("[]").end_array();
+
+    EXPECT_EQ(out, R"([{"a":1},[]])");
+}
+
+namespace
+{
+struct BenchmarkWindow
+{
+    int id;
+    std::string name;
+    int x, y, width, height;
+    bool focused;
+};
+
+std::vector<BenchmarkWindow> make_windows(int count)
+{
+    std::vector<BenchmarkWindow> windows;
+    for (int i = 0; i < count; i++)
+        windows.push_back({ i, "Terminal - window " + std::to_string(i), i * 10, i * 5, 640, 480, i == 0 });
+    return windows;
+}
+
+std::string serialize_with_dom(std::vector<BenchmarkWindow> const& windows)
+{
+    json nodes = json::array();
+    for (auto const& window : windows)
+    {
+        nodes.push_back({
+            { "id",      window.id                                                                                     },
+            { "name",    window.name                                                                                   },
+            { "type",    "con"                                                                                         },
+            { "focused", window.focused                                                                                },
+            { "rect",    { { "x", window.x }, { "y", window.y }, { "width", window.width }, { "height", window.height } } }
+        });
+    }
+
+    json root = {
+        { "id",    0      },
+        { "name",  "root" },
+        { "nodes", nodes  }
+    };
+    return to_string(root);
+}
+
+void serialize_with_writer(std::vector<BenchmarkWindow> const& windows, std::string& out)
+{
+    out.clear();
+    JsonWriter writer(out);
+    writer.begin_object()
+        .field("id", 0)
+        .field("name", "root")
+        .key("nodes")
+        .begin_array();
+    for (auto const& window : windows)
+    {
+        writer.begin_object()
+            .field("id", window.id)
+            .field("name", window.name)
+            .field("type", "con")
+            .field("focused", window.focused)
+            .key("rect")
+            .begin_object()
+            .field("x", window.x)
+            .field("y", window.y)
+            .field("width", window.width)
+            .field("height", window.height)
+            .end_object()
+            .end_object();
+    }
+    writer.end_array().end_object();
+}
+}
+
+/// The streaming writer produces the same document as building an
+/// nlohmann::json document and serializing it, for trees of 10, 100 and
+/// 1000 windows, including when its output buffer is reused.
+TEST(JsonWriterTest, MatchesDocumentSerialization)
+{
+    for (int num_windows : { 10, 100, 1000 })
+    {
+        auto windows = make_windows(num_windows);
+        auto const expected = json::parse(serialize_with_dom(windows));
+
+        std::string out;
+        serialize_with_writer(windows, out);
+        ASSERT_EQ(json::parse(out), expected);
+
+        // The output buffer is reused between documents, as it would be for a cached tree
+        serialize_with_writer(windows, out);
+        EXPECT_EQ(json::parse(out), expected);
+    }
+}
@@ -0,0 +1,180 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "opaque_region.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+namespace geom = mir::geometry;
+
+namespace
+{
+geom::Rectangle rect(int x, int y, int width, int height)
+{
+    return { geom::Point { x, y }, geom::Size { width, height } };
+}
+}
+
+TEST(OpaqueRegionTest, EmptyRegionCoversNothing)
+{
+    OpaqueRegion region;
+    EXPECT_FALSE(region.covers(rect(0, 0, 10, 10)));
+}
+
+TEST(OpaqueRegionTest, EmptyAreaIsAlwaysCovered)
+{
+    OpaqueRegion region;
+    EXPECT_TRUE(region.covers(rect(0, 0, 0, 10)));
+}
+
+TEST(OpaqueRegionTest, AreaInsideASingleRectangleIsCovered)
+{
+    OpaqueRegion region;
+    region.add(rect(0, 0, 100, 100));
+    EXPECT_TRUE(region.covers(rect(10, 10, 50, 50)));
+    EXPECT_TRUE(region.covers(rect(0, 0, 100, 100)));
+}
+
+TEST(OpaqueRegionTest, AreaPokingOutIsNotCovered)
+{
+    OpaqueRegion region;
+    region.add(rect(0, 0, 100, 100));
+    EXPECT_FALSE(region.covers(rect(50, 50, 51, 10)));
+    EXPECT_FALSE(region.covers(rect(-1, 0, 10, 10)));
+}
+
+TEST(OpaqueRegionTest, AreaCoveredByAdjacentRectanglesIsCovered)
+{
+    OpaqueRegion region;
+    region.add(rect(0, 0, 50, 100));
+    region.add(rect(50, 0, 50, 40));
+    region.add(rect(50, 40, 50, 60));
+    EXPECT_TRUE(region.covers(rect(20, 20, 60, 60)));
+}
+
+TEST(OpaqueRegionTest, GapBetweenRectanglesIsNotCovered)
+{
+    OpaqueRegion region;
+    region.add(rect(0, 0, 50, 100));
+    region.add(rect(51, 0, 49, 100));
+    EXPECT_FALSE(region.covers(rect(0, 0, 100, 100)));
+}
+
+TEST(OpaqueRegionTest, ClearForgetsEverything)
+{
+    OpaqueRegion region;
+    region.add(rect(0, 0, 100, 100));
+    region.clear();
+    EXPECT_FALSE(region.covers(rect(0, 0, 10, 10)));
+}
+
+TEST(OpaqueRegionTest, PlainLayerIsOpaqueWhereItIsDrawn)
+{
+    OpaqueRegion::Layer layer;
+    layer.screen_position = rect(10, 20, 100, 50);
+    EXPECT_EQ(OpaqueRegion::opaque_area(layer), rect(10, 20, 100, 50));
+}
+
+TEST(OpaqueRegionTest, ShapedTranslucentOrTransformedLayersAreNotOpaque)
+{
+    OpaqueRegion::Layer layer;
+    layer.screen_position = rect(0, 0, 100, 100);
+
+    auto shaped = layer;
+    shaped.shaped = true;
+    EXPECT_EQ(OpaqueRegion::opaque_area(shaped), std::nullopt);
+
+    auto translucent = layer;
+    translucent.alpha = 0.5f;
+    EXPECT_EQ(OpaqueRegion::opaque_area(translucent), std::nullopt);
+
+    auto transformed = layer;
+    transformed.transformation[0][0] = 0.5f;
+    EXPECT_EQ(OpaqueRegion::opaque_area(transformed), std::nullopt);
+}
+
+TEST(OpaqueRegionTest, ScaledWorkspaceIsNotOpaque)
+{
+    OpaqueRegion::Layer layer;
+    layer.screen_position = rect(0, 0, 100, 100);
+    layer.to_viewport[1][1] = 0.5f;
+    EXPECT_EQ(OpaqueRegion::opaque_area(layer), std::nullopt);
+}
+
+TEST(OpaqueRegionTest, TranslatedWorkspaceOnlyCountsWholePixels)
+{
+    OpaqueRegion::Layer layer;
+    layer.screen_position = rect(0, 0, 100, 100);
+    layer.to_viewport[3] = glm::vec4(10.5f, -20.f, 0.f, 1.f);
+    EXPECT_EQ(OpaqueRegion::opaque_area(layer), rect(11, -20, 99, 100));
+}
+
+TEST(OpaqueRegionTest, ClippedLayerIsOnlyOpaqueInsideItsClip)
+{
+    OpaqueRegion::Layer layer;
+    layer.screen_position = rect(0, 0, 100, 100);
+    layer.clip_area = rect(50, 0, 100, 40);
+    EXPECT_EQ(OpaqueRegion::opaque_area(layer), rect(50, 0, 50, 40));
+}
+
+namespace
+{
+OpaqueRegion::Layer window(geom::Rectangle const& position, float alpha = 1.f)
+{
+    OpaqueRegion::Layer layer;
+    layer.bounds = position;
+    layer.screen_position = position;
+    layer.alpha = alpha;
+    return layer;
+}
+
+/// Culls [layers], listed bottom to top, as the renderer does and returns how many are drawn
+int count_draws(std::vector<OpaqueRegion::Layer> const& layers)
+{
+    OpaqueRegion region;
+    int draws = 0;
+    for (auto it = layers.rbegin(); it != layers.rend(); ++it)
+    {
+        if (!region.cull(*it))
+            draws++;
+    }
+    return draws;
+}
+
+std::vector<OpaqueRegion::Layer> tiled_windows()
+{
+    std::vector<OpaqueRegion::Layer> layers;
+    for (int row = 0; row < 4; row++)
+        for (int column = 0; column < 5; column++)
+            layers.push_back(window(rect(column * 768, row * 540, 768, 540)));
+    return layers;
+}
+}
+
+TEST(OpaqueRegionTest, FullscreenWindowCullsTheTiledWindowsBeneathIt)
+{
+    auto layers = tiled_windows();
+    layers.push_back(window(rect(0, 0, 3840, 2160)));
+    EXPECT_EQ(count_draws(layers), 1);
+}
+
+TEST(OpaqueRegionTest, TranslucentFullscreenWindowCullsNothing)
+{
+    auto layers = tiled_windows();
+    layers.push_back(window(rect(0, 0, 3840, 2160), 0.9f));
+    EXPECT_EQ(count_draws(layers), 21);
+}
@@ -0,0 +1,70 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "renderer_statistics.h"
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+int const first = 0;
+int const second = 0;
+}
+
+TEST(RendererStatisticsTest, CountsFramesPerRenderer)
+{
+    RendererStatistics statistics;
+    statistics.add_frame(&first, 100, 2);
+    statistics.add_frame(&first, 30, 0);
+    statistics.add_frame(&second, 50, 1);
+
+    auto const stats = statistics.get(&first);
+    EXPECT_EQ(stats.frames, 2u);
+    EXPECT_EQ(stats.pixels_redrawn, 130u);
+    EXPECT_EQ(stats.last_frame_pixels_redrawn, 30u);
+    EXPECT_EQ(stats.culled_draws, 2u);
+    EXPECT_EQ(stats.last_frame_culled_draws, 0u);
+}
+
+TEST(RendererStatisticsTest, TotalsEveryRenderer)
+{
+    RendererStatistics statistics;
+    statistics.add_frame(&first, 100, 2);
+    statistics.add_frame(&second, 50, 1);
+
+    auto const total = statistics.get();
+    EXPECT_EQ(total.frames, 2u);
+    EXPECT_EQ(total.pixels_redrawn, 150u);
+    EXPECT_EQ(total.last_frame_pixels_redrawn, 150u);
+    EXPECT_EQ(total.culled_draws, 3u);
+}
+
+TEST(RendererStatisticsTest, RemovedRenderersStayInTheTotals)
+{
+    RendererStatistics statistics;
+    statistics.add_frame(&first, 100, 2);
+    statistics.add_frame(&second, 50, 1);
+    statistics.remove(&first);
+
+    EXPECT_EQ(statistics.get(&first).frames, 0u);
+    auto const total = statistics.get();
+    EXPECT_EQ(total.frames, 2u);
+    EXPECT_EQ(total.pixels_redrawn, 150u);
+    EXPECT_EQ(total.last_frame_pixels_redrawn, 50u);
+    EXPECT_EQ(total.culled_draws, 3u);
+}
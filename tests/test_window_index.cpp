@@ -0,0 +1,104 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "window_index.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+
+using namespace miracle;
+
+namespace
+{
+std::vector<uint64_t> sorted(std::vector<uint64_t> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+}
+
+TEST(WindowIndexTest, FindsWindowsByTitleAndAppId)
+{
+    WindowIndex index;
+    index.add(1, {}, "Terminal", "foot");
+    index.add(2, {}, "Terminal", "alacritty");
+    index.add(3, {}, "Mozilla Firefox", "firefox");
+
+    EXPECT_EQ(sorted(index.find_by_title("Terminal")), (std::vector<uint64_t> { 1, 2 }));
+    EXPECT_EQ(index.find_by_app_id("firefox"), (std::vector<uint64_t> { 3 }));
+    EXPECT_TRUE(index.find_by_title("Nothing").empty());
+    EXPECT_EQ(index.size(), 3u);
+}
+
+TEST(WindowIndexTest, RemovedWindowsAreNoLongerFound)
+{
+    WindowIndex index;
+    index.add(1, {}, "Terminal", "foot");
+    index.add(2, {}, "Terminal", "foot");
+    index.remove(1);
+
+    EXPECT_FALSE(index.contains(1));
+    EXPECT_TRUE(index.contains(2));
+    EXPECT_EQ(index.find_by_title("Terminal"), (std::vector<uint64_t> { 2 }));
+    EXPECT_EQ(index.find_by_app_id("foot"), (std::vector<uint64_t> { 2 }));
+}
+
+TEST(WindowIndexTest, RenamedWindowsAreFoundByTheirNewTitle)
+{
+    WindowIndex index;
+    index.add(1, {}, "Loading...", "firefox");
+    index.update(1, "Mozilla Firefox", "firefox");
+
+    EXPECT_TRUE(index.find_by_title("Loading...").empty());
+    EXPECT_EQ(index.find_by_title("Mozilla Firefox"), (std::vector<uint64_t> { 1 }));
+    EXPECT_EQ(index.find_by_app_id("firefox"), (std::vector<uint64_t> { 1 }));
+}
+
+TEST(WindowIndexTest, AddingAnIndexedIdReplacesIt)
+{
+    WindowIndex index;
+    index.add(1, {}, "Old", "old");
+    index.add(1, {}, "New", "new");
+
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_TRUE(index.find_by_title("Old").empty());
+    EXPECT_EQ(index.find_by_app_id("new"), (std::vector<uint64_t> { 1 }));
+}
+
+TEST(WindowIndexTest, MatchesAreListedInTheOrderTheyWereAdded)
+{
+    WindowIndex index;
+    index.add(30, {}, "Terminal", "foot");
+    index.add(10, {}, "Terminal", "foot");
+    index.add(20, {}, "Terminal", "foot");
+    index.update(30, "Editor", "foot");
+    index.update(30, "Terminal", "foot");
+
+    EXPECT_EQ(index.find_by_title("Terminal"), (std::vector<uint64_t> { 30, 10, 20 }));
+    EXPECT_EQ(index.find_by_app_id("foot"), (std::vector<uint64_t> { 30, 10, 20 }));
+
+    std::vector<uint64_t> all;
+    index.for_each([&](uint64_t id) { all.push_back(id); });
+    EXPECT_EQ(all, (std::vector<uint64_t> { 30, 10, 20 }));
+}
+
+TEST(WindowIndexTest, UpdatingAnUnknownWindowDoesNothing)
+{
+    WindowIndex index;
+    index.update(1, "Title", "app");
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(index.get(1), nullptr);
+}
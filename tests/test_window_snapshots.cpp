@@ -0,0 +1,150 @@
+/**
+Copyright (C) 2024  Matthew Kosarek
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "window_snapshots.h"
+#include <gtest/gtest.h>
+#include <mir/graphics/buffer.h>
+
+using namespace miracle;
+
+namespace
+{
+class StubBuffer : public mir::graphics::Buffer
+{
+public:
+    explicit StubBuffer(mir::geometry::Size size) :
+        _size { size }
+    {
+    }
+
+    mir::graphics::BufferID id() const override { return {}; }
+    mir::geometry::Size size() const override { return _size; }
+    MirPixelFormat pixel_format() const override { return mir_pixel_format_argb_8888; }
+    mir::graphics::NativeBufferBase* native_buffer_base() override { return nullptr; }
+
+private:
+    mir::geometry::Size _size;
+};
+
+class StubRenderable : public mir::graphics::Renderable
+{
+public:
+    explicit StubRenderable(mir::geometry::Size size) :
+        _buffer { std::make_shared<StubBuffer>(size) },
+        rect { { 0, 0 }, size }
+    {
+    }
+
+    ID id() const override { return this; }
+    std::shared_ptr<mir::graphics::Buffer> buffer() const override { return _buffer; }
+    mir::geometry::Rectangle screen_position() const override { return rect; }
+    mir::geometry::RectangleD src_bounds() const override { return {}; }
+    std::optional<mir::geometry::Rectangle> clip_area() const override { return {}; }
+    float alpha() const override { return 1.f; }
+    glm::mat4 transformation() const override { return glm::mat4(1.f); }
+    bool shaped() const override { return true; }
+    std::optional<mir::scene::Surface const*> surface_if_any() const override { return {}; }
+
+private:
+    std::shared_ptr<mir::graphics::Buffer> _buffer;
+    mir::geometry::Rectangle rect;
+};
+
+/// The last frame of a 100x100 window, which takes 40000 bytes
+mir::graphics::RenderableList make_frame()
+{
+    return { std::make_shared<StubRenderable>(mir::geometry::Size(100, 100)) };
+}
+
+constexpr size_t frame_bytes = 100 * 100 * 4;
+}
+
+TEST(WindowSnapshotsTest, SnapshotKeepsTheBufferAlive)
+{
+    WindowSnapshots snapshots;
+    auto frame = make_frame();
+    std::weak_ptr<mir::graphics::Buffer> buffer = frame[0]->buffer();
+    ASSERT_TRUE(snapshots.add(1, frame, glm::mat4(1.f), frame_bytes));
+    frame.clear();
+
+    EXPECT_FALSE(buffer.expired());
+    EXPECT_EQ(snapshots.memory_used(), frame_bytes);
+
+    int drawn = 0;
+    snapshots.for_each([&](std::shared_ptr<mir::graphics::Renderable const> const& renderable, glm::mat4 const&)
+    {
+        EXPECT_EQ(renderable->buffer(), buffer.lock());
+        EXPECT_EQ(renderable->surface_if_any(), std::nullopt);
+        drawn++;
+    });
+    EXPECT_EQ(drawn, 1);
+}
+
+TEST(WindowSnapshotsTest, AnimationStepsAreAppliedAndCompletionDropsTheSnapshot)
+{
+    WindowSnapshots snapshots;
+    ASSERT_TRUE(snapshots.add(1, make_frame(), glm::mat4(1.f), frame_bytes));
+
+    glm::mat4 half(0.5f);
+    half[3][3] = 1.f;
+    std::shared_ptr<mir::graphics::Renderable const> before;
+    snapshots.for_each([&](std::shared_ptr<mir::graphics::Renderable const> const& renderable, glm::mat4 const&)
+    {
+        before = renderable;
+    });
+
+    snapshots.on_animation({ 1, false, std::nullopt, std::nullopt, half, 0.25f });
+    snapshots.for_each([&](std::shared_ptr<mir::graphics::Renderable const> const& renderable, glm::mat4 const&)
+    {
+        EXPECT_EQ(renderable->transformation(), half);
+        EXPECT_FLOAT_EQ(renderable->alpha(), 0.25f);
+    });
+
+    // A renderable that is being drawn is not changed underneath the renderer
+    EXPECT_EQ(before->transformation(), glm::mat4(1.f));
+    EXPECT_FLOAT_EQ(before->alpha(), 1.f);
+
+    snapshots.on_animation({ 1, true });
+    EXPECT_EQ(snapshots.size(), 0u);
+    EXPECT_EQ(snapshots.memory_used(), 0u);
+}
+
+TEST(WindowSnapshotsTest, OldestSnapshotsAreDroppedToStayWithinTheLimit)
+{
+    WindowSnapshots snapshots;
+    auto const limit = 2 * frame_bytes;
+    ASSERT_TRUE(snapshots.add(1, make_frame(), glm::mat4(1.f), limit));
+    ASSERT_TRUE(snapshots.add(2, make_frame(), glm::mat4(1.f), limit));
+    ASSERT_TRUE(snapshots.add(3, make_frame(), glm::mat4(1.f), limit));
+
+    EXPECT_EQ(snapshots.size(), 2u);
+    EXPECT_EQ(snapshots.memory_used(), limit);
+
+    // Steps for the evicted snapshot are ignored
+    snapshots.on_animation({ 1, true });
+    EXPECT_EQ(snapshots.size(), 2u);
+}
+
+TEST(WindowSnapshotsTest, SnapshotLargerThanTheLimitIsNotKept)
+{
+    WindowSnapshots snapshots;
+    ASSERT_TRUE(snapshots.add(1, make_frame(), glm::mat4(1.f), frame_bytes));
+
+    EXPECT_FALSE(snapshots.add(2, make_frame(), glm::mat4(1.f), frame_bytes - 1));
+    EXPECT_FALSE(snapshots.add(3, {}, glm::mat4(1.f), frame_bytes));
+    EXPECT_EQ(snapshots.size(), 1u);
+}
@@ -92,6 +92,8 @@ public:
     void set_user_data(miral::Window const&, std::shared_ptr<void> const&) override { }
     void modify(miral::Window const&, miral::WindowSpecification const&) override { }
     miral::WindowInfo& info_for(miral::Window const&) override { }
+    void begin_batch() override { }
+    void end_batch() override { }
 
 private:
     std::vector<std::pair<miral::Window, std::shared_ptr<Container>>>& pairs;